@@ -0,0 +1,102 @@
+#include <field.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <boost/endian/conversion.hpp>
+
+#include <libpq-fe.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace {
+
+constexpr int num_rows = 1024;
+
+struct result_deleter {
+  void operator()(PGresult* res) const { PQclear(res); }
+};
+
+using result_ptr = std::unique_ptr<PGresult, result_deleter>;
+
+template <class T>
+std::string binary_value(T value) {
+  if constexpr (std::is_same_v<T, std::string>) {
+    return value;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    using uint_t = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+
+    uint_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    return binary_value(bits);
+  } else {
+    const auto big = boost::endian::native_to_big(value);
+
+    return {reinterpret_cast<const char*>(&big), sizeof(big)};
+  }
+}
+
+/**
+ * Builds a result of \ref num_rows rows of a single column in binary format,
+ * as the server would send it, so that decoding is measured on its own.
+ */
+template <class T>
+result_ptr make_result(T value) {
+  result_ptr res{PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK)};
+
+  PGresAttDesc attr{};
+  attr.name = const_cast<char*>("value");
+  attr.format = 1;
+  attr.typlen = -1;
+
+  if (!PQsetResultAttrs(res.get(), 1, &attr))
+    throw std::runtime_error{"could not set result attributes"};
+
+  auto data = binary_value(value);
+
+  for (int i = 0; i < num_rows; ++i) {
+    if (!PQsetvalue(res.get(), i, 0, data.data(), static_cast<int>(data.size())))
+      throw std::runtime_error{"could not set result value"};
+  }
+
+  return res;
+}
+
+template <class T, class ValueT>
+void decode(benchmark::State& state, ValueT value) {
+  const auto res = make_result(value);
+
+  for (auto _ : state) {
+    for (int i = 0; i < num_rows; ++i)
+      benchmark::DoNotOptimize(postgrespp::field{res.get(), static_cast<std::size_t>(i), 0}.as<T>());
+  }
+
+  state.SetItemsProcessed(state.iterations() * num_rows);
+}
+
+void field_as_int16(benchmark::State& state) { decode<std::int16_t>(state, std::int16_t{12345}); }
+void field_as_int32(benchmark::State& state) { decode<std::int32_t>(state, std::int32_t{123456789}); }
+void field_as_int64(benchmark::State& state) { decode<std::int64_t>(state, std::int64_t{1234567890123}); }
+void field_as_float(benchmark::State& state) { decode<float>(state, 1.5f); }
+void field_as_double(benchmark::State& state) { decode<double>(state, 3.25); }
+void field_as_optional_int32(benchmark::State& state) {
+  decode<std::optional<std::int32_t>>(state, std::int32_t{123456789});
+}
+void field_as_string(benchmark::State& state) {
+  decode<std::string>(state, std::string(state.range(0), 'x'));
+}
+
+}
+
+BENCHMARK(field_as_int16);
+BENCHMARK(field_as_int32);
+BENCHMARK(field_as_int64);
+BENCHMARK(field_as_float);
+BENCHMARK(field_as_double);
+BENCHMARK(field_as_optional_int32);
+BENCHMARK(field_as_string)->Arg(8)->Arg(64)->Arg(1024);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,45 @@
+#include <utility.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+using postgrespp::utility::param_binding;
+
+namespace {
+
+/// Measures binding parameters the way they are passed to PQsendQueryParams.
+template <class... Params>
+void encode(benchmark::State& state, const Params&... params) {
+  for (auto _ : state) {
+    const param_binding<Params...> binding{params...};
+
+    benchmark::DoNotOptimize(binding.values());
+    benchmark::DoNotOptimize(binding.lengths());
+  }
+
+  state.SetItemsProcessed(state.iterations() * sizeof...(Params));
+}
+
+void encode_int32(benchmark::State& state) { encode(state, std::int32_t{123456789}); }
+void encode_int64(benchmark::State& state) { encode(state, std::int64_t{1234567890123}); }
+void encode_double(benchmark::State& state) { encode(state, 3.25); }
+void encode_c_string(benchmark::State& state) { encode(state, "a short string"); }
+void encode_string(benchmark::State& state) { encode(state, std::string(state.range(0), 'x')); }
+
+void encode_mixed(benchmark::State& state) {
+  encode(state, std::int16_t{1}, std::int32_t{2}, std::int64_t{3}, 4.5, std::string{"row"});
+}
+
+}
+
+BENCHMARK(encode_int32);
+BENCHMARK(encode_int64);
+BENCHMARK(encode_double);
+BENCHMARK(encode_c_string);
+BENCHMARK(encode_string)->Arg(8)->Arg(64)->Arg(1024);
+BENCHMARK(encode_mixed);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,147 @@
+#include <async_exec.hpp>
+#include <async_exec_prepared.hpp>
+#include <connection.hpp>
+#include <work.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <optional>
+#include <string>
+
+using namespace postgrespp;
+
+namespace {
+
+/// Overridden by the POSTGRESPP_BENCH_CONN environment variable.
+const char* conn_string() {
+  const auto env = std::getenv("POSTGRESPP_BENCH_CONN");
+
+  return env ? env : "host=127.0.0.1 user=postgres";
+}
+
+/**
+ * A connection to the local server. Benchmarks are skipped if it cannot be
+ * established.
+ */
+class bench_connection {
+public:
+  explicit bench_connection(benchmark::State& state) {
+    try {
+      c_.emplace(ioc_, conn_string());
+    } catch (const std::exception& e) {
+      state.SkipWithError(e.what());
+    }
+  }
+
+  explicit operator bool() const { return c_.has_value(); }
+
+  connection& operator*() { return *c_; }
+
+  /// Runs the io_context until all operations are done.
+  void run() {
+    ioc_.restart();
+    ioc_.run();
+  }
+
+private:
+  connection::io_context_t ioc_;
+  std::optional<connection> c_;
+};
+
+/**
+ * Measures the round trip of \p start, which is called with a handler to
+ * pass its result to, on each iteration.
+ */
+template <class StartT>
+void round_trip(benchmark::State& state, bench_connection& c, StartT&& start) {
+  for (auto _ : state) {
+    std::optional<result> res;
+
+    start([&res](result r) { res.emplace(std::move(r)); });
+    c.run();
+
+    if (!res || !res->ok()) {
+      state.SkipWithError(res ? res->error_message() : "no result");
+      break;
+    }
+  }
+}
+
+void exec_connection(benchmark::State& state) {
+  bench_connection c{state};
+  if (!c) return;
+
+  round_trip(state, c, [&](auto&& handler) {
+        async_exec(*c, "SELECT 1", std::move(handler));
+      });
+}
+
+void exec_transaction(benchmark::State& state) {
+  bench_connection c{state};
+  if (!c) return;
+
+  std::optional<work> txn;
+  (*c).async_transaction<>([&txn](work t) { txn.emplace(std::move(t)); });
+  c.run();
+
+  round_trip(state, c, [&](auto&& handler) {
+        async_exec(*txn, "SELECT 1", std::move(handler));
+      });
+
+  txn->commit([](auto&&) {});
+  c.run();
+}
+
+void exec_unprepared(benchmark::State& state) {
+  bench_connection c{state};
+  if (!c) return;
+
+  round_trip(state, c, [&](auto&& handler) {
+        async_exec(*c, "SELECT $1::int4, $2::text", std::move(handler), std::int32_t{42}, "text");
+      });
+}
+
+void exec_prepared(benchmark::State& state) {
+  bench_connection c{state};
+  if (!c) return;
+
+  (*c).async_prepare("bench_stmt", "SELECT $1::int4, $2::text", [](auto&&) {});
+  c.run();
+
+  round_trip(state, c, [&](auto&& handler) {
+        async_exec_prepared(*c, "bench_stmt", std::move(handler), std::int32_t{42}, "text");
+      });
+}
+
+/// Round trip of a query returning state.range(0) rows, decoded in full.
+void exec_rows(benchmark::State& state) {
+  bench_connection c{state};
+  if (!c) return;
+
+  const auto rows = static_cast<std::int32_t>(state.range(0));
+
+  round_trip(state, c, [&](auto&& handler) {
+        async_exec(*c, "SELECT i, i::int8, i::text FROM generate_series(1, $1) i",
+            [handler = std::move(handler)](result res) mutable {
+              for (const auto& row : res.template as<std::tuple<std::int32_t, std::int64_t, std::string>>())
+                benchmark::DoNotOptimize(row);
+
+              handler(std::move(res));
+            }, rows);
+      });
+
+  state.SetItemsProcessed(state.iterations() * rows);
+}
+
+}
+
+BENCHMARK(exec_connection)->UseRealTime();
+BENCHMARK(exec_transaction)->UseRealTime();
+BENCHMARK(exec_unprepared)->UseRealTime();
+BENCHMARK(exec_prepared)->UseRealTime();
+BENCHMARK(exec_rows)->Arg(1)->Arg(100)->Arg(10000)->UseRealTime();
+
+BENCHMARK_MAIN();
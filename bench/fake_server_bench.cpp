@@ -0,0 +1,67 @@
+#include <fake_server.hpp>
+
+#include <async_exec.hpp>
+#include <connection.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+using namespace postgrespp;
+using postgrespp::testing::fake_server;
+
+namespace {
+
+/**
+ * Round trips against \ref fake_server, which answers from memory, so that
+ * the time is spent in the library, libpq and the loopback socket rather
+ * than in the server.
+ */
+void fake_exec(benchmark::State& state, const fake_server::options& opts) {
+  const auto rows = static_cast<std::int32_t>(state.range(0));
+
+  fake_server server{opts};
+
+  fake_server::response res;
+  res.columns = {{"i", 23}, {"t", 25}};
+  for (std::int32_t i = 0; i < rows; ++i)
+    res.rows.push_back({fake_server::binary(i), std::string(16, 'x')});
+  server.on("SELECT i, t FROM t WHERE i < $1", res);
+
+  connection::io_context_t ioc;
+  connection c{ioc, server.conn_string().c_str()};
+
+  for (auto _ : state) {
+    std::optional<result> r;
+
+    async_exec(c, "SELECT i, t FROM t WHERE i < $1", [&r](result res) { r.emplace(std::move(res)); }, rows);
+
+    ioc.restart();
+    ioc.run();
+
+    if (!r || !r->ok()) {
+      state.SkipWithError(r ? r->error_message() : "no result");
+      break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * rows);
+}
+
+void fake_exec_rows(benchmark::State& state) {
+  fake_exec(state, {});
+}
+
+/// Like \ref fake_exec_rows with the answers split into writes of 64 bytes.
+void fake_exec_rows_partial_writes(benchmark::State& state) {
+  fake_exec(state, {/* write_chunk_size */ 64, /* write_delay */ {}});
+}
+
+}
+
+BENCHMARK(fake_exec_rows)->Arg(0)->Arg(100)->Arg(10000)->UseRealTime();
+BENCHMARK(fake_exec_rows_partial_writes)->Arg(100)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "basic_connection.hpp"
+
+#include <utility>
+
+namespace postgrespp {
+
+/**
+ * Asynchronously connects to a server without blocking \p exc.
+ * \p handler is called with an error code and the connection.
+ * See \ref basic_connection::async_connect(exc, pgconninfo, handler).
+ */
+template <class ExecutorT, class CompletionTokenT>
+auto async_connect(ExecutorT&& exc, const char* const& pgconninfo,
+    CompletionTokenT&& handler) {
+  return basic_connection::async_connect(std::forward<ExecutorT>(exc), pgconninfo,
+      std::forward<CompletionTokenT>(handler));
+}
+
+}
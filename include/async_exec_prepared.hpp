@@ -1,11 +1,9 @@
 #pragma once
 
+#include "basic_connection.hpp"
 #include "work.hpp"
 #include "statement_name.hpp"
 
-#include <boost/asio/async_result.hpp>
-
-#include <memory>
 #include <utility>
 
 namespace postgrespp {
@@ -21,46 +19,14 @@ auto async_exec_prepared(basic_transaction<RWT, IsolationT>& t, const statement_
 }
 
 /**
- * Starts a transaction, asynchronously executes a prepared query and commits
- * the transaction.
+ * Asynchronously executes a prepared query in an implicit transaction.
+ * See \ref basic_connection::async_exec_prepared(statement_name, handler, params).
  * This function must not be called again before the handler is called.
  */
 template <class ResultCallableT, class... Params>
-auto async_exec_prepared(basic_connection& c, statement_name name,
-    ResultCallableT&& handler, Params... params) {
-  auto initiation = [](auto&& handler, basic_connection& c, statement_name name, auto&&... params) mutable {
-   c.template async_transaction<>([
-      handler = std::move(handler),
-      name = std::move(name),
-      params...](auto txn) mutable {
-        auto ptxn = std::make_unique<work>(std::move(txn));
-        auto& txn_ref = *ptxn;
-
-        auto wrapped_handler = [handler = std::move(handler), ptxn = std::move(ptxn)](auto&& result) mutable {
-            if (result.ok()) {
-              auto& txn_ref = *ptxn;
-              txn_ref.commit([ptxn = std::move(ptxn), handler = std::move(handler), result = std::move(result)]
-                            (auto&& commit_result) mutable {
-                  if (commit_result.ok()) {
-                    handler(std::move(result));
-                  } else {
-                    handler(std::move(commit_result));
-                  }
-                });
-            } else {
-              handler(std::move(result));
-            }
-          };
-
-        async_exec_prepared(txn_ref, name, std::move(wrapped_handler),
-            std::move(params)...);
-      });
-  };
-
-  return boost::asio::async_initiate<
-    ResultCallableT, void(result)>(
-        initiation, handler, std::ref(c), std::move(name),
-        std::forward<decltype(params)>(params)...);
+auto async_exec_prepared(basic_connection& c, const statement_name& name,
+    ResultCallableT&& handler, Params&&... params) {
+  return c.async_exec_prepared(name, std::forward<ResultCallableT>(handler), std::forward<Params>(params)...);
 }
 
 }
@@ -1,18 +1,33 @@
 #pragma once
 
 #include "basic_transaction.hpp"
+#include "error.hpp"
+#include "notification.hpp"
+#include "pending_operation.hpp"
 #include "query.hpp"
 #include "socket_operations.hpp"
+#include "static_query.hpp"
+#include "statement_cache.hpp"
+#include "tracing.hpp"
 #include "utility.hpp"
 
 #include <libpq-fe.h>
 
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/bind_executor.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/system_executor.hpp>
 
+#include <functional>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace postgrespp {
 
@@ -22,11 +37,15 @@ class basic_transaction;
 class result;
 
 class basic_connection : public socket_operations<basic_connection> {
-  friend class socket_operations<basic_connection>;
+  template <class>
+  friend class socket_operations;
+  template <class, class>
+  friend class basic_transaction;
 public:
   using io_context_t = boost::asio::io_context;
   using result_t = result;
   using socket_t = boost::asio::ip::tcp::socket;
+  using executor_type = socket_t::executor_type;
   using query_t = query;
   using statement_name_t = std::string;
 
@@ -35,8 +54,17 @@ public:
     : basic_connection{standalone_ioc(), pgconninfo} {
   }
 
+  /**
+   * Connects to the server. This blocks the calling thread until the
+   * connection is established; see \ref async_connect() for a non-blocking
+   * alternative.
+   * \p exc an execution context or executor. The results of the connection
+   * are received on it and handlers without an associated executor are
+   * called on it, so with an io_context run by several threads, it should be
+   * a strand.
+   */
   template <class ExecutorT>
-  basic_connection(ExecutorT& exc, const char* const& pgconninfo)
+  basic_connection(ExecutorT&& exc, const char* const& pgconninfo)
     : socket_{exc} {
     c_ = PQconnectdb(pgconninfo);
 
@@ -46,12 +74,8 @@ public:
     if (PQsetnonblocking(c_, 1) != 0)
       throw std::runtime_error{"could not set non-blocking: " + std::string{PQerrorMessage(c_)}};
 
-    const auto socket = PQsocket(c_);
-
-    if (socket < 0)
+    if (!assign_socket())
       throw std::runtime_error{"could not get a valid descriptor"};
-
-    socket_.assign(boost::asio::ip::tcp::v4(), socket);
   }
 
   ~basic_connection();
@@ -60,8 +84,27 @@ public:
 
   basic_connection(basic_connection&& rhs) noexcept
     : socket_{std::move(rhs.socket_)}
-    , c_{std::move(rhs.c_)} {
+    , c_{std::move(rhs.c_)}
+    , recycler_{std::move(rhs.recycler_)}
+    , pending_{std::move(rhs.pending_)}
+    , receiving_{rhs.receiving_}
+    , statements_{std::move(rhs.statements_)}
+    , reading_{rhs.reading_}
+    , writing_{rhs.writing_}
+    , sync_scheduled_{rhs.sync_scheduled_}
+    , exit_pipeline_scheduled_{rhs.exit_pipeline_scheduled_}
+    , transient_pipeline_{rhs.transient_pipeline_}
+    , transient_open_{rhs.transient_open_}
+    , transient_last_{rhs.transient_last_}
+    , transient_done_{std::move(rhs.transient_done_)}
+    , notification_waiter_{std::move(rhs.notification_waiter_)}
+    , rollback_scheduled_{rhs.rollback_scheduled_} {
     rhs.c_ = nullptr;
+
+#ifdef POSTGRESPP_TRACING
+    tracer_ = rhs.tracer_;
+    next_trace_ = rhs.next_trace_;
+#endif
   }
 
   basic_connection& operator=(basic_connection const&) = delete;
@@ -71,6 +114,24 @@ public:
 
     swap(socket_, rhs.socket_);
     swap(c_, rhs.c_);
+    swap(recycler_, rhs.recycler_);
+    swap(pending_, rhs.pending_);
+    swap(receiving_, rhs.receiving_);
+    swap(statements_, rhs.statements_);
+    swap(reading_, rhs.reading_);
+    swap(writing_, rhs.writing_);
+    swap(sync_scheduled_, rhs.sync_scheduled_);
+    swap(exit_pipeline_scheduled_, rhs.exit_pipeline_scheduled_);
+    swap(transient_pipeline_, rhs.transient_pipeline_);
+    swap(transient_open_, rhs.transient_open_);
+    swap(transient_last_, rhs.transient_last_);
+    swap(transient_done_, rhs.transient_done_);
+    swap(notification_waiter_, rhs.notification_waiter_);
+    swap(rollback_scheduled_, rhs.rollback_scheduled_);
+#ifdef POSTGRESPP_TRACING
+    swap(tracer_, rhs.tracer_);
+    swap(next_trace_, rhs.next_trace_);
+#endif
 
     return *this;
   }
@@ -80,35 +141,84 @@ public:
       const statement_name_t& statement_name,
       const query_t& query,
       CompletionTokenT&& handler) {
-    const auto res = PQsendPrepare(connection().underlying_handle(),
-        statement_name.c_str(),
-        query.c_str(),
-        0,
-        nullptr);
+    return async_prepare(statement_name, query_view{query}, param_types{},
+        std::forward<CompletionTokenT>(handler));
+  }
 
-    if (res != 1) {
-      throw std::runtime_error{
-        "error preparing statement '" + statement_name + "': " + std::string{connection().last_error_message()}};
-    }
+  /**
+   * Prepares \p query as \p statement_name with the parameter types of
+   * \p query instead of letting the server infer them.
+   */
+  template <class... Ts, class CompletionTokenT>
+  auto async_prepare(
+      const statement_name_t& statement_name,
+      const static_query<Ts...>& query,
+      CompletionTokenT&& handler) {
+    return async_prepare(statement_name, query_view{query.c_str()}, query.types(),
+        std::forward<CompletionTokenT>(handler));
+  }
 
-    return handle_exec(std::forward<CompletionTokenT>(handler));
+  /**
+   * Execute a single query asynchronously outside of an explicit
+   * transaction. The server runs the query in an implicit transaction that is
+   * committed if it succeeds, which saves the round trips of BEGIN and COMMIT.
+   * \p handler will be called once with the result.
+   * \p params parameters to pass in the same order to $1, $2, ...
+   *
+   * This function must not be called again before the handler is called
+   * unless the connection is in pipeline mode.
+   */
+  template <class ResultCallableT, class... Params>
+  auto async_exec(query_view query, ResultCallableT&& handler,
+      Params&&... params) {
+    return send_query(query, std::forward<ResultCallableT>(handler),
+        std::forward<Params>(params)...);
+  }
+
+  /**
+   * Execute a query whose parameter types are known at compile time outside
+   * of an explicit transaction. See
+   * \ref basic_transaction::async_exec(static_query, handler, params).
+   */
+  template <class... Ts, class ResultCallableT, class... Params>
+  auto async_exec(const static_query<Ts...>& query, ResultCallableT&& handler,
+      Params&&... params) {
+    return send_query(query, std::forward<ResultCallableT>(handler),
+        std::forward<Params>(params)...);
   }
 
   /**
-   * Creates a read/write transaction. Make sure the created transaction
-   * object lives until you are done with it.
+   * Execute a prepared statement asynchronously outside of an explicit
+   * transaction. See \ref async_exec(query, handler, params) for more.
+   */
+  template <class ResultCallableT, class... Params>
+  auto async_exec_prepared(const statement_name_t& statement_name,
+      ResultCallableT&& handler, Params&&... params) {
+    return send_query_prepared(statement_name,
+        std::forward<ResultCallableT>(handler), std::forward<Params>(params)...);
+  }
+
+  /**
+   * Creates a transaction of \p RWT, one of \ref read_write, \ref read_only
+   * or \ref deferrable, with isolation level \p IsolationT, one of
+   * \ref read_committed, \ref repeatable_read or \ref serializable. void
+   * uses the defaults of the server.
+   * \p handler is called with the transaction right away. Nothing is sent
+   * until its first statement, which is pipelined behind the BEGIN. Make sure
+   * the transaction object lives until you are done with it.
    */
   template <
-    class Unused_RWT = void,
-    class Unused_IsolationT = void,
+    class RWT = void,
+    class IsolationT = void,
     class TransactionHandlerT>
   auto async_transaction(TransactionHandlerT&& handler) {
-    using txn_t = basic_transaction<Unused_RWT, Unused_IsolationT>;
+    using txn_t = basic_transaction<RWT, IsolationT>;
 
     auto initiation = [this](auto&& handler) {
-      auto w = std::make_shared<txn_t>(*this);
-      w->async_exec("BEGIN",
-          [handler = std::move(handler), w](auto&& res) mutable { handler(std::move(*w)); } );
+      const auto exc = boost::asio::get_associated_executor(handler, get_executor());
+
+      boost::asio::post(get_executor(), boost::asio::bind_executor(exc,
+            [this, handler = std::move(handler)]() mutable { handler(txn_t{*this}); }));
     };
 
     return boost::asio::async_initiate<
@@ -116,6 +226,197 @@ public:
           initiation, handler);
   }
 
+  /**
+   * Connects asynchronously without blocking \p exc during the TCP and TLS
+   * handshakes and authentication.
+   * \p handler is called with an error code and the connection. If the
+   * connection could not be established, the error code is
+   * \ref error::connection_failed and the reason is available from
+   * \ref last_error_message() of the passed connection.
+   */
+  template <class ExecutorT, class CompletionTokenT>
+  static auto async_connect(ExecutorT&& exc, const char* const& pgconninfo,
+      CompletionTokenT&& handler) {
+    // The arguments are copied, as the initiation may be deferred.
+    auto initiation = [](auto&& handler, const executor_type& exc, const std::string& pgconninfo) {
+      std::unique_ptr<basic_connection> c{
+        new basic_connection{exc, connect_start_t{}, pgconninfo.c_str()}};
+      auto& c_ref = *c;
+
+      c_ref.wait_connect_ready(socket_t::wait_write,
+          [handler = std::move(handler), c = std::move(c)](const boost::system::error_code& ec) mutable {
+            handler(ec, std::move(*c));
+          });
+    };
+
+    return boost::asio::async_initiate<
+      CompletionTokenT, void(boost::system::error_code, basic_connection)>(
+          initiation, handler, socket_executor(exc), std::string{pgconninfo});
+  }
+
+  /**
+   * Starts listening for notifications on \p channel. \p handler is called
+   * with the result of the LISTEN command. The notifications are received
+   * with \ref async_wait_notification().
+   */
+  template <class ResultCallableT>
+  auto async_listen(const std::string& channel, ResultCallableT&& handler) {
+    return async_exec("LISTEN " + escape_identifier(channel),
+        std::forward<ResultCallableT>(handler));
+  }
+
+  /**
+   * Stops listening for notifications on \p channel. A wait in progress
+   * continues for the other channels, see \ref cancel_wait_notification().
+   */
+  template <class ResultCallableT>
+  auto async_unlisten(const std::string& channel, ResultCallableT&& handler) {
+    return async_exec("UNLISTEN " + escape_identifier(channel),
+        std::forward<ResultCallableT>(handler));
+  }
+
+  /**
+   * Waits for notifications on the channels listened to. \p handler is
+   * called with an error code and all the notifications that have been
+   * received, at least one, once there are any. Notifications are received
+   * while the connection is idle as well as together with the results of
+   * queries. Only one wait may be in progress at a time.
+   *
+   * The wait is completed with boost::asio::error::operation_aborted by
+   * \ref cancel_wait_notification() and when the connection is destructed.
+   */
+  template <class CompletionTokenT>
+  auto async_wait_notification(CompletionTokenT&& handler) {
+    auto initiation = [this](auto&& handler) {
+      using handler_t = std::decay_t<decltype(handler)>;
+
+      if (notification_waiter_)
+        throw std::runtime_error{"already waiting for notifications"};
+
+      notification_waiter_ = std::make_unique<notification_waiter_impl<handler_t>>(std::move(handler));
+
+      // Notifications may have been received with the results of queries.
+      boost::asio::post(socket_.get_executor(), [this] { poll_notifications(); });
+    };
+
+    return boost::asio::async_initiate<
+      CompletionTokenT, void(boost::system::error_code, std::vector<notification>)>(
+          initiation, handler);
+  }
+
+  /**
+   * Completes the wait for notifications in progress, if any, with
+   * boost::asio::error::operation_aborted.
+   */
+  void cancel_wait_notification();
+
+  /// Escapes \p identifier for use as an SQL identifier, adding quotes.
+  std::string escape_identifier(const std::string& identifier) {
+    const auto escaped = PQescapeIdentifier(c_, identifier.c_str(), identifier.size());
+
+    if (!escaped) {
+      throw std::runtime_error{
+        "error escaping identifier: " + std::string{last_error_message()}};
+    }
+
+    std::string ret{escaped};
+    PQfreemem(escaped);
+
+    return ret;
+  }
+
+  /// Escapes \p literal for use as an SQL string literal, adding quotes.
+  std::string escape_literal(const std::string& literal) {
+    const auto escaped = PQescapeLiteral(c_, literal.c_str(), literal.size());
+
+    if (!escaped) {
+      throw std::runtime_error{
+        "error escaping literal: " + std::string{last_error_message()}};
+    }
+
+    std::string ret{escaped};
+    PQfreemem(escaped);
+
+    return ret;
+  }
+
+  /**
+   * Requests the server to cancel the query it is running, without blocking
+   * the executor of the connection. \p handler is called with an error code
+   * once the request has been delivered. The cancelled query completes as
+   * usual, with an error of SQLSTATE 57014 if it was still running; in
+   * pipeline mode, the queries after it up to the next synchronization point
+   * are aborted too.
+   *
+   * With libpq 17, the request is sent asynchronously on the executor of the
+   * connection; before that, a blocking request is sent from a thread of
+   * its own.
+   */
+  template <class CompletionTokenT>
+  auto async_cancel(CompletionTokenT&& handler) {
+    auto initiation = [this](auto&& handler) {
+      using handler_t = std::decay_t<decltype(handler)>;
+
+      cancel([handler = std::make_shared<handler_t>(std::move(handler))](
+            const boost::system::error_code& ec) {
+            complete_handler(*handler, ec);
+          });
+    };
+
+    return boost::asio::async_initiate<
+      CompletionTokenT, void(boost::system::error_code)>(
+          initiation, handler);
+  }
+
+  /// Identifies the operation queued last, 0 if there is none, see \ref cancel_running().
+  operation_queue::id_type last_operation() const { return pending_.back_id(); }
+
+  /**
+   * Cancels the query of operation \p id with \ref async_cancel() if the
+   * server is running it and none of its results have been received.
+   * Returns false without cancelling if it is queued behind other queries,
+   * its results are being received or it is done.
+   */
+  bool cancel_running(operation_queue::id_type id);
+
+  /**
+   * Enters libpq pipeline mode. While in pipeline mode, queries can be sent
+   * without waiting for the results of the previous ones; every handler is
+   * still called with its own result, in the order the queries were sent.
+   * Queries sent during the same turn of the executor are flushed together,
+   * followed by a single synchronization point.
+   *
+   * Must be called while no query is in progress.
+   */
+  void enter_pipeline_mode();
+
+  /**
+   * Leaves pipeline mode. If results of queries sent in pipeline mode are
+   * still pending, pipeline mode is left once they have all been received.
+   */
+  void exit_pipeline_mode();
+
+  bool pipeline_mode() const;
+
+  /**
+   * Makes \ref async_exec() and \ref basic_transaction::async_exec() prepare
+   * up to \p capacity of the queries they execute, keyed by query text, and
+   * execute them as prepared statements afterwards. When the cache is full,
+   * the least recently used statement is closed. 0, the default, disables
+   * the cache. Throws if more statements are cached than \p capacity.
+   *
+   * The first execution of a query sends the statement and executes it in
+   * the same round trip; outside of pipeline mode, the connection is in
+   * pipeline mode until its results have been received. The parameter types
+   * are inferred by the server when the statement is prepared. Statements
+   * must not be deallocated by other means, e.g. DISCARD ALL.
+   */
+  void set_statement_cache_capacity(std::size_t capacity) { statements_.set_capacity(capacity); }
+
+  std::size_t statement_cache_capacity() const { return statements_.capacity(); }
+
+  executor_type get_executor() { return socket_.get_executor(); }
+
   PGconn* underlying_handle() { return c_; }
 
   const PGconn* underlying_handle() const { return c_; }
@@ -124,17 +425,263 @@ public:
 
   const char* last_error_message() const { return PQerrorMessage(underlying_handle()); }
 
+#ifdef POSTGRESPP_TRACING
+  /**
+   * Passes the timeline of each query sent from now on to \p t, or stops
+   * tracing if it is nullptr. \p t must outlive the queries.
+   */
+  void set_tracer(tracing::tracer* t) { tracer_ = t; }
+#endif
+
 private:
+  struct connect_start_t {};
+
+  /// The executor of a socket constructed with \p exc, an executor or an execution context.
+  template <class ExecutorT>
+  static executor_type socket_executor(ExecutorT& exc) {
+    if constexpr (std::is_convertible_v<ExecutorT&, boost::asio::execution_context&>)
+      return exc.get_executor();
+    else
+      return exc;
+  }
+
+  /// Prepares \p query as \p statement_name, declaring its parameter types as \p types.
+  template <class CompletionTokenT>
+  auto async_prepare(
+      const statement_name_t& statement_name,
+      query_view query,
+      param_types types,
+      CompletionTokenT&& handler) {
+    const auto res = PQsendPrepare(connection().underlying_handle(),
+        statement_name.c_str(),
+        query.c_str(),
+        types.size,
+        types.oids);
+
+    if (res != 1) {
+      throw std::runtime_error{
+        "error preparing statement '" + statement_name + "': " + std::string{connection().last_error_message()}};
+    }
+
+    return handle_exec(std::forward<CompletionTokenT>(handler));
+  }
+
+  /// Starts connecting without waiting for the connection to be established.
+  template <class ExecutorT>
+  basic_connection(ExecutorT&& exc, connect_start_t, const char* const& pgconninfo)
+    : socket_{exc}
+    , c_{PQconnectStart(pgconninfo)} {
+  }
+
+  template <class ConnectHandlerT>
+  void wait_connect_ready(socket_t::wait_type wait, ConnectHandlerT&& handler) {
+    if (status() == CONNECTION_BAD || !assign_socket()) {
+      boost::asio::post(socket_.get_executor(), [handler = std::move(handler)]() mutable {
+            handler(error::connection_failed);
+          });
+      return;
+    }
+
+    socket_.async_wait(wait, [this, handler = std::move(handler)](const auto& ec) mutable {
+          on_connect_ready(std::move(handler), ec);
+        });
+  }
+
+  template <class ConnectHandlerT>
+  void on_connect_ready(ConnectHandlerT&& handler, const boost::system::error_code& ec) {
+    if (ec) {
+      handler(ec);
+      return;
+    }
+
+    switch (PQconnectPoll(c_)) {
+      case PGRES_POLLING_READING:
+        wait_connect_ready(socket_t::wait_read, std::move(handler));
+        break;
+      case PGRES_POLLING_WRITING:
+        wait_connect_ready(socket_t::wait_write, std::move(handler));
+        break;
+      case PGRES_POLLING_OK:
+        if (PQsetnonblocking(c_, 1) != 0 || !assign_socket())
+          handler(error::connection_failed);
+        else
+          handler(boost::system::error_code{});
+        break;
+      default:
+        handler(error::connection_failed);
+        break;
+    }
+  }
+
+  using cancel_handler_t = std::function<void(const boost::system::error_code&)>;
+
+  /// See \ref async_cancel().
+  void cancel(cancel_handler_t handler);
+
+  /**
+   * (Re)assigns the current descriptor of the connection to the socket.
+   * libpq may replace the descriptor while connecting.
+   */
+  bool assign_socket();
+
   int status() const;
 
   basic_connection& connection() { return *this; }
 
   io_context_t& standalone_ioc();
 
+  /**
+   * Queues \p op to receive the results of the query that has just been sent
+   * and makes sure the query is flushed and its results are read.
+   */
+  void enqueue(pending_operation::ptr op);
+
+  statement_cache& statements() { return statements_; }
+
+  /**
+   * Enters pipeline mode to send a few queries in one round trip, until
+   * \ref end_transient_pipeline(). Must be called while no query is in
+   * progress.
+   */
+  void begin_transient_pipeline();
+
+  /**
+   * Queues \p last, the operation of the last query sent, followed by a
+   * synchronization point. Pipeline mode is left once that is received and
+   * \p last is completed only then, so that its handler may send queries
+   * that are not allowed in pipeline mode.
+   */
+  void end_transient_pipeline(pending_operation::ptr last);
+
+  /**
+   * Sends the synchronization point of the transient pipeline, making the
+   * operation queued last the one completed once it is received.
+   */
+  void sync_transient_pipeline();
+
+  /**
+   * Ends the transient pipeline after a query could not be sent. Pipeline
+   * mode is left right away if nothing has been queued in it, otherwise it
+   * is synchronized so that the queries before complete.
+   */
+  void abort_transient_pipeline();
+
+  /**
+   * Starts the trace of \p query, which has just been sent. Its operation
+   * is the next one queued that is traced.
+   */
+  void trace_send([[maybe_unused]] std::string_view query) {
+#ifdef POSTGRESPP_TRACING
+    if (tracer_) {
+      next_trace_.traced = true;
+      next_trace_.statement = tracer_->on_send(query);
+      next_trace_.sent = tracing::clock::now();
+    }
+#endif
+  }
+
+  /// Counts \p size bytes sent for the next trace.
+  void trace_bytes([[maybe_unused]] std::size_t size) {
+#ifdef POSTGRESPP_TRACING
+    next_trace_.bytes_sent += size;
+#endif
+  }
+
+  /**
+   * Sends \p query, the BEGIN of a \ref basic_transaction, ignoring its
+   * result. Outside of pipeline mode, it is sent in a transient pipeline that
+   * is synced once the current handler returns, so that the statements sent
+   * until then are pipelined behind it and aborted if it fails.
+   */
+  void send_begin(const char* query);
+
+  /**
+   * Rolls back the transaction of an abandoned \ref basic_transaction
+   * without waiting for the result. If queries are in progress outside of
+   * pipeline mode, the ROLLBACK is sent right after the last one is done.
+   * Does not throw.
+   */
+  void abandon_transaction() noexcept;
+
+  /// Sends a ROLLBACK whose result is ignored, see \ref abandon_transaction().
+  void send_rollback() noexcept;
+
+  /// Calls the handler of \p op, completing its trace.
+  void dispatch(pending_operation& op);
+
+  /// Memory for the pending operations, which must not outlive it.
+  operation_recycler& recycler() { return *recycler_; }
+
+  /// Returns true if the results of a query are still pending.
+  bool busy() const { return !pending_.empty(); }
+
+  void schedule_pipeline_sync();
+
+  /**
+   * Same as \ref exit_pipeline_mode(), but returns false instead of throwing
+   * if pipeline mode cannot be left, for the handlers of the socket.
+   */
+  bool try_exit_pipeline_mode();
+
+  void wait_read_ready();
+
+  void wait_write_ready();
+
+  void on_read_ready(const boost::system::error_code& ec);
+
+  void on_write_ready(const boost::system::error_code& ec);
+
+  /// Passes the notifications received so far to the waiter, if any.
+  void deliver_notifications();
+
+  /// Delivers notifications and keeps reading while they are awaited.
+  void poll_notifications();
+
+  /**
+   * Completes all pending operations with an error after the connection has
+   * failed, so that no error escapes from the handlers of the socket.
+   */
+  void fail_pending();
+
 private:
   socket_t socket_;
 
   PGconn* c_;
+
+  std::unique_ptr<operation_recycler> recycler_ = std::make_unique<operation_recycler>();
+
+  operation_queue pending_;
+
+  /// The operation whose results have started to arrive, see \ref cancel_running().
+  operation_queue::id_type receiving_ = 0;
+
+  statement_cache statements_;
+
+  bool reading_ = false;
+  bool writing_ = false;
+  bool sync_scheduled_ = false;
+  bool exit_pipeline_scheduled_ = false;
+
+  bool transient_pipeline_ = false;
+
+  /// Between \ref begin_transient_pipeline() and \ref end_transient_pipeline().
+  bool transient_open_ = false;
+
+  /// See \ref end_transient_pipeline().
+  pending_operation* transient_last_ = nullptr;
+  pending_operation::ptr transient_done_;
+
+  notification_waiter::ptr notification_waiter_;
+
+  /// See \ref abandon_transaction().
+  bool rollback_scheduled_ = false;
+
+#ifdef POSTGRESPP_TRACING
+  tracing::tracer* tracer_ = nullptr;
+
+  /// See \ref trace_send().
+  tracing::query_trace next_trace_;
+#endif
 };
 
 }
@@ -1,25 +1,53 @@
 #pragma once
 
-#include "field_type.hpp"
+#include "copy_in_writer.hpp"
+#include "copy_out_reader.hpp"
 #include "query.hpp"
 #include "socket_operations.hpp"
-#include "type_encoder.hpp"
-#include "utility.hpp"
+#include "static_query.hpp"
+#include "transaction_mode.hpp"
+
+#include <libpq-fe.h>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/post.hpp>
 
 #include <cassert>
+#include <iterator>
+#include <stdexcept>
+#include <string>
 #include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace postgrespp {
 
 class basic_connection;
 
+/**
+ * A transaction of \p RWT, one of \ref read_write, \ref read_only or
+ * \ref deferrable, with isolation level \p IsolationT, one of
+ * \ref read_committed, \ref repeatable_read or \ref serializable. void uses
+ * the defaults of the server.
+ *
+ * BEGIN is only sent with the first statement. Statements that can be
+ * pipelined are sent right behind it without waiting for its result, and are
+ * aborted if it fails. \ref async_exec_stream(), \ref async_copy_in() and
+ * \ref async_copy_out() wait for it instead, and \ref async_exec_all() sends
+ * it as the first query of the string.
+ */
 template <class RWT, class IsolationT>
 class basic_transaction : public socket_operations<basic_transaction<RWT, IsolationT>> {
   friend class socket_operations<basic_transaction<RWT, IsolationT>>;
 public:
+  /// Whether the transaction only reads, e.g. to route it to a read replica.
+  static constexpr bool is_read_only = is_read_only_v<RWT>;
+
   using query_t = query;
   using connection_t = ::postgrespp::basic_connection;
   using statement_name_t = std::string;
+  using copy_in_writer_t = basic_copy_in_writer<connection_t>;
 
 private:
   using result_t = typename socket_operations<basic_transaction<RWT, IsolationT>>::result_t;
@@ -27,13 +55,15 @@ private:
 public:
   basic_transaction(connection_t& c)
     : c_{c}
-    , done_{false} {
+    , done_{false}
+    , begun_{false} {
   }
 
   basic_transaction(const basic_transaction&) = delete;
   basic_transaction(basic_transaction&& rhs) noexcept
     : c_{std::move(rhs.c_)}
-    , done_{std::move(rhs.done_)} {
+    , done_{std::move(rhs.done_)}
+    , begun_{rhs.begun_} {
     rhs.done_ = true;
   }
 
@@ -43,33 +73,44 @@ public:
 
     swap(c_, rhs.c_);
     swap(done_, rhs.done_);
+    swap(begun_, rhs.begun_);
+
+    return *this;
   }
 
   /**
    * Destructor.
-   * If neither \ref commit() nor \ref rollback() has been used, destructing
-   * will do a sync rollback.
+   * If neither \ref commit() nor \ref rollback() has been used, a ROLLBACK
+   * is queued on the connection without waiting for it. It is sent once the
+   * queries in progress are done, before any query sent after this.
+   * Until its result arrives, the connection stays in pipeline mode so that
+   * those queries are pipelined behind it; \ref async_exec_all() and COPY
+   * cannot be used in the meantime. Nothing is sent if no statement has
+   * been.
    */
   ~basic_transaction() {
-    if (!done_) {
-      const result_t res{PQexec(connection().underlying_handle(), "ROLLBACK")};
-      assert(result_t::status_t::COMMAND_OK == res.status());
-    }
+    if (!done_ && begun_)
+      connection().abandon_transaction();
   }
   
   /// See \ref async_exec(query, handler, params) for more.
   template <class ResultCallableT>
-  auto async_exec(const query_t& query, ResultCallableT&& handler) {
-    return async_exec_2(query, std::forward<ResultCallableT>(handler),
-        nullptr, nullptr, nullptr, 0);
+  auto async_exec(query_view query, ResultCallableT&& handler) {
+    assert(!done_);
+    begin();
+
+    return this->send_query(query, std::forward<ResultCallableT>(handler));
   }
 
   /// See \ref async_exec_prepared(statement_name, handler, params) for more.
   template <class ResultCallableT>
   auto async_exec_prepared(const statement_name_t& statement_name,
       ResultCallableT&& handler) {
-    return async_exec_prepared_2(statement_name,
-        std::forward<ResultCallableT>(handler), nullptr, nullptr, nullptr, 0);
+    assert(!done_);
+    begin();
+
+    return this->send_query_prepared(statement_name,
+        std::forward<ResultCallableT>(handler));
   }
 
   /**
@@ -79,22 +120,32 @@ public:
    * \p handler will be called once with the result.
    * \p params parameters to pass in the same order to $1, $2, ...
    *
-   * This function must not be called again before the handler is called.
+   * This function must not be called again before the handler is called
+   * unless the connection is in pipeline mode.
    */
   template <class ResultCallableT, class... Params>
-  auto async_exec(const query_t& query, ResultCallableT&& handler,
+  auto async_exec(query_view query, ResultCallableT&& handler,
       Params&&... params) {
-    using namespace utility;
+    assert(!done_);
+    begin();
 
-    const auto value_holders = create_value_holders(params...);
-    const auto value_arr = std::apply(
-        [this](auto&&... args) { return value_array(args...); },
-        value_holders);
-    const auto size_arr = size_array(params...);
-    const auto type_arr = type_array(params...);
+    return this->send_query(query, std::forward<ResultCallableT>(handler),
+        std::forward<Params>(params)...);
+  }
 
-    return async_exec_2(query, std::forward<ResultCallableT>(handler),
-        value_arr.data(), size_arr.data(), type_arr.data(), sizeof...(params));
+  /**
+   * Execute a query whose parameter types are known at compile time.
+   * The types are sent along with \p query, and \p params must be of those
+   * types. See \ref async_exec(query, handler, params) for more.
+   */
+  template <class... Ts, class ResultCallableT, class... Params>
+  auto async_exec(const static_query<Ts...>& query, ResultCallableT&& handler,
+      Params&&... params) {
+    assert(!done_);
+    begin();
+
+    return this->send_query(query, std::forward<ResultCallableT>(handler),
+        std::forward<Params>(params)...);
   }
 
   /**
@@ -104,23 +155,208 @@ public:
    * \p handler will be called once with the result.
    * \p params parameters to pass in the same order to $1, $2, ...
    *
-   * This function must not be called again before the handler is called.
+   * This function must not be called again before the handler is called
+   * unless the connection is in pipeline mode.
    */
   template <class ResultCallableT, class... Params>
   auto async_exec_prepared(const statement_name_t& statement_name,
       ResultCallableT&& handler, Params&&... params) {
-    using namespace utility;
+    assert(!done_);
+    begin();
+
+    return this->send_query_prepared(statement_name,
+        std::forward<ResultCallableT>(handler), std::forward<Params>(params)...);
+  }
+
+  /**
+   * Execute a statement asynchronously with many sets of parameters.
+   * \p query must contain a single statement. It is prepared once and
+   * executed with each tuple of \p param_sets in order, without waiting for
+   * the results in between.
+   * \p param_sets a range of std::tuple or std::pair of parameters to pass in
+   * the same order to $1, $2, ...
+   * \p handler will be called once with a \ref batch_result holding the
+   * affected rows of each execution and the first error. The executions after
+   * an error are not done.
+   *
+   * This function must not be called again before the handler is called
+   * unless the connection is in pipeline mode. Outside of pipeline mode, no
+   * other query may be in progress on the connection.
+   */
+  template <class ParamSetRangeT, class BatchCallableT>
+  auto async_exec_batch(query_view query, const ParamSetRangeT& param_sets,
+      BatchCallableT&& handler) {
+    assert(!done_);
+    begin();
+
+    return this->send_batch(query, param_types{}, param_sets,
+        std::forward<BatchCallableT>(handler));
+  }
+
+  /**
+   * Same as above with the parameter types of \p query sent along. The
+   * elements of \p param_sets must be of those types.
+   */
+  template <class... Ts, class ParamSetRangeT, class BatchCallableT>
+  auto async_exec_batch(const static_query<Ts...>& query, const ParamSetRangeT& param_sets,
+      BatchCallableT&& handler) {
+    using param_set_t = std::decay_t<decltype(*std::begin(param_sets))>;
+
+    static_assert(static_query<Ts...>::template accepts_param_set<param_set_t>(),
+        "parameters do not match the types of the query");
+
+    assert(!done_);
+    begin();
+
+    return this->send_batch(query.c_str(), query.types(), param_sets,
+        std::forward<BatchCallableT>(handler));
+  }
+
+  /**
+   * Execute a query asynchronously and stream its rows instead of buffering
+   * them all in a single result.
+   * \p rows_per_chunk maximum number of rows per chunk. Chunks of more than
+   * one row require libpq 17; with older versions, every chunk has one row.
+   * \p chunk_handler will be called with a result for each chunk of rows as
+   * they arrive. More rows are not read from the connection until it returns.
+   * \p handler will be called once with the final result, which has no rows
+   * unless the query failed.
+   * \p params parameters to pass in the same order to $1, $2, ...
+   *
+   * This function must not be called again before the handler is called and
+   * no other query may be in progress on the connection. As the first
+   * statement of the transaction, \p query and \p params are copied to be
+   * sent after BEGIN; the data of views among them must outlive the handler.
+   */
+  template <class ChunkCallableT, class ResultCallableT, class... Params>
+  auto async_exec_stream(query_view query, std::size_t rows_per_chunk,
+      ChunkCallableT&& chunk_handler, ResultCallableT&& handler,
+      Params&&... params) {
+    assert(!done_);
+
+    if (!begun_) {
+      return begin_then<void(result_t)>(std::forward<ResultCallableT>(handler),
+          [&c = connection(), query = std::string{query.c_str()}, rows_per_chunk,
+           chunk_handler = std::forward<ChunkCallableT>(chunk_handler),
+           params = std::make_tuple(std::forward<Params>(params)...)](result_t res, auto&& handler) mutable {
+            if (!res.ok())
+              return complete_handler(handler, std::move(res));
+
+            try {
+              c.check_can_stream();
+              std::apply([&](auto&... params) { c.send_query_params(query, params...); }, params);
+              c.set_rows_per_chunk(rows_per_chunk);
+            } catch (const std::exception&) {
+              return complete_handler(handler, send_error(c));
+            }
+
+            c.handle_exec_stream(std::move(chunk_handler), std::move(handler));
+          });
+    }
 
-    const auto value_holders = create_value_holders(params...);
-    const auto value_arr = std::apply(
-        [this](auto&&... args) { return value_array(args...); },
-        value_holders);
-    const auto size_arr = size_array(params...);
-    const auto type_arr = type_array(params...);
+    this->check_can_stream();
+    this->send_query_params(query, std::forward<Params>(params)...);
+    this->set_rows_per_chunk(rows_per_chunk);
 
-    return async_exec_prepared_2(statement_name,
-        std::forward<ResultCallableT>(handler), value_arr.data(),
-        size_arr.data(),type_arr.data(), sizeof...(params));
+    return this->handle_exec_stream(std::forward<ChunkCallableT>(chunk_handler),
+        std::forward<ResultCallableT>(handler));
+  }
+
+  /**
+   * Starts copying rows into \p table asynchronously in binary COPY format.
+   * \p table is used verbatim, so it may be schema-qualified.
+   * \p columns names of the columns the rows consist of, or empty for all
+   * columns of the table.
+   * \p handler will be called with the result of the COPY statement and a
+   * \ref basic_copy_in_writer to write the rows with. The writer must only be
+   * used if the result is ok, and no other query can be executed in the
+   * transaction until its \ref basic_copy_in_writer::async_finish() handler is
+   * called.
+   */
+  template <class CompletionTokenT>
+  auto async_copy_in(const std::string& table,
+      const std::vector<std::string>& columns, CompletionTokenT&& handler) {
+    assert(!done_);
+
+    std::string query = "COPY " + table;
+
+    if (!columns.empty()) {
+      query += " (";
+      for (std::size_t i = 0; i < columns.size(); ++i) {
+        if (i > 0) query += ", ";
+        query += escape_identifier(columns[i]);
+      }
+      query += ")";
+    }
+
+    query += " FROM STDIN (FORMAT binary)";
+
+    if (!begun_) {
+      return begin_then<void(result_t, copy_in_writer_t)>(std::forward<CompletionTokenT>(handler),
+          [&c = connection(), query = std::move(query)](result_t res, auto&& handler) {
+            if (!res.ok())
+              return complete_handler(handler, std::move(res), copy_in_writer_t{c});
+
+            try {
+              c.send_query_params(query);
+            } catch (const std::exception&) {
+              return complete_handler(handler, send_error(c), copy_in_writer_t{c});
+            }
+
+            c.handle_copy(std::move(handler), copy_in_writer_t{c});
+          });
+    }
+
+    this->send_query_params(query);
+
+    return this->handle_copy(std::forward<CompletionTokenT>(handler),
+        copy_in_writer_t{connection()});
+  }
+
+  /**
+   * Execute a COPY TO STDOUT query asynchronously and stream its rows in
+   * binary COPY format.
+   * \p query a COPY ... TO STDOUT (FORMAT binary) statement.
+   * \p row_handler will be called with a \ref binary_copy::row for each row as
+   * it arrives. The row refers to data that is freed once it returns. More
+   * rows are not read from the connection until it returns. If it throws, or
+   * the data is not in binary format, no more rows are passed to it.
+   * \p handler will be called once with the result of the COPY statement, or
+   * \ref error::unexpected_result if the rows could not be handled.
+   * \p params parameters to pass in the same order to $1, $2, ...
+   *
+   * This function must not be called again before the handler is called and
+   * it cannot be used in pipeline mode. As the first statement of the
+   * transaction, \p query and \p params are copied, see
+   * \ref async_exec_stream().
+   */
+  template <class RowCallableT, class ResultCallableT, class... Params>
+  auto async_copy_out(query_view query, RowCallableT&& row_handler,
+      ResultCallableT&& handler, Params&&... params) {
+    assert(!done_);
+
+    if (!begun_) {
+      return begin_then<void(result_t)>(std::forward<ResultCallableT>(handler),
+          [&c = connection(), query = std::string{query.c_str()},
+           row_handler = std::forward<RowCallableT>(row_handler),
+           params = std::make_tuple(std::forward<Params>(params)...)](result_t res, auto&& handler) mutable {
+            if (!res.ok())
+              return complete_handler(handler, std::move(res));
+
+            try {
+              std::apply([&](auto&... params) { c.send_query_params(query, params...); }, params);
+            } catch (const std::exception&) {
+              return complete_handler(handler, send_error(c));
+            }
+
+            c.handle_copy_out(std::move(row_handler), std::move(handler));
+          });
+    }
+
+    this->send_query_params(query, std::forward<Params>(params)...);
+
+    return this->handle_copy_out(std::forward<RowCallableT>(row_handler),
+        std::forward<ResultCallableT>(handler));
   }
 
   /**
@@ -131,12 +367,16 @@ public:
    * empty result where \ref result.done() returns true.
    *
    * This function must not be called again before the handler is called
-   * with a result where \ref result.done() returns true.
+   * with a result where \ref result.done() returns true. It cannot be used
+   * in pipeline mode.
    */
   template <class ResultCallableT>
-  auto async_exec_all(const query_t& query, ResultCallableT&& handler) {
+  auto async_exec_all(query_view query, ResultCallableT&& handler) {
     assert(!done_);
 
+    if (!begun_)
+      return begin_with_all(query, std::forward<ResultCallableT>(handler));
+
     const auto res = PQsendQuery(connection().underlying_handle(),
         query.c_str());
 
@@ -145,91 +385,140 @@ public:
         "error executing query: " + std::string{connection().last_error_message()}};
     }
 
+    this->trace_query(query.c_str());
+
     return this->handle_exec_all(std::forward<ResultCallableT>(handler));
   }
 
+  /**
+   * Commits the transaction. It is finished once this returns, so it may be
+   * destructed before \p handler is called. If no statement has been sent,
+   * neither is COMMIT and \p handler gets an empty successful result.
+   */
   template <class ResultCallableT>
   auto commit(ResultCallableT&& handler) {
-    const auto initiation = [this](auto&& handler) {
-      async_exec("COMMIT", [this, handler = std::move(handler)](auto&& res) mutable {
-          done_ = true;
-          handler(std::forward<decltype(res)>(res));
-        });
-    };
-
-    return boost::asio::async_initiate<
-      ResultCallableT, void(result_t)>(
-          initiation, handler);
+    return finish("COMMIT", std::forward<ResultCallableT>(handler));
   }
 
+  /// Rolls back the transaction, see \ref commit().
   template <class ResultCallableT>
   auto rollback(ResultCallableT&& handler) {
-    const auto initiation = [this](auto&& handler) {
-      async_exec("ROLLBACK", [this, handler = std::move(handler)](auto&& res) mutable {
-          done_ = true;
-          handler(std::forward<decltype(res)>(res));
-        });
-    };
-
-    return boost::asio::async_initiate<
-      ResultCallableT, void(result_t)>(
-          initiation, handler);
+    return finish("ROLLBACK", std::forward<ResultCallableT>(handler));
   }
 
 protected:
   auto& connection() { return c_.get(); }
 
+  std::string escape_identifier(const std::string& identifier) {
+    return connection().escape_identifier(identifier);
+  }
+
   auto& socket() { return connection().socket(); }
 
 private:
-  template <class ResultCallableT>
-  auto async_exec_2(const query_t& query, ResultCallableT&& handler,
-      const char* const* value_arr, const int* size_arr, const int* type_arr,
-      std::size_t num_values) {
-    assert(!done_);
+  /// Sends BEGIN ahead of the next statement unless it has been already.
+  void begin() {
+    if (begun_)
+      return;
 
-    const auto res = PQsendQueryParams(connection().underlying_handle(),
-        query.c_str(),
-        num_values,
-        nullptr,
-        value_arr,
-        size_arr,
-        type_arr,
-        static_cast<int>(field_type::BINARY));
+    connection().send_begin(begin_statement<RWT, IsolationT>());
+    begun_ = true;
+  }
 
-    if (res != 1) {
+  /**
+   * Sends BEGIN on its own, for the statements that must not be pipelined
+   * behind it. Once it is done, \p send is called with its result and the
+   * handler, to send the statement or complete the handler with the error.
+   * \p send must not throw, as it is called from the connection; a statement
+   * that cannot be sent completes the handler with \ref send_error().
+   */
+  template <class SignatureT, class CompletionTokenT, class SendT>
+  auto begin_then(CompletionTokenT&& token, SendT&& send) {
+    auto& c = connection();
+
+    c.send_query_params(begin_statement<RWT, IsolationT>());
+    begun_ = true;
+
+    auto initiation = [&c](auto&& handler, auto&& send) {
+      c.handle_exec([handler = std::move(handler), send = std::move(send)](result_t res) mutable {
+            send(std::move(res), std::move(handler));
+          });
+    };
+
+    return boost::asio::async_initiate<
+      CompletionTokenT, SignatureT>(
+          initiation, token, std::forward<SendT>(send));
+  }
+
+  /**
+   * Sends BEGIN as the first query of \p query, see \ref async_exec_all().
+   * Its result is not passed to the handler unless it failed.
+   */
+  template <class ResultCallableT>
+  auto begin_with_all(query_view query, ResultCallableT&& handler) {
+    const std::string queries = std::string{begin_statement<RWT, IsolationT>()} + "; " + query.c_str();
+
+    if (PQsendQuery(connection().underlying_handle(), queries.c_str()) != 1) {
       throw std::runtime_error{
-        "error executing query '" + query + "': " + std::string{connection().last_error_message()}};
+        "error executing query: " + std::string{connection().last_error_message()}};
     }
 
-    return this->handle_exec(std::forward<ResultCallableT>(handler));
+    this->trace_query(query.c_str());
+    begun_ = true;
+
+    auto initiation = [this](auto&& handler) {
+      this->handle_exec_all([handler = std::move(handler), first = true](result_t res) mutable {
+            if (std::exchange(first, false) && res.status() == result_t::status_t::COMMAND_OK)
+              return;
+
+            handler(std::move(res));
+          });
+    };
+
+    return boost::asio::async_initiate<
+      ResultCallableT, void(result_t)>(
+          initiation, handler);
+  }
+
+  /// The result of a statement that could not be sent after BEGIN.
+  template <class ConnectionT>
+  static result_t send_error(ConnectionT& c) {
+    return result_t{PQmakeEmptyPGresult(c.underlying_handle(), PGRES_FATAL_ERROR)};
   }
 
   template <class ResultCallableT>
-  auto async_exec_prepared_2(const statement_name_t& statement_name,
-      ResultCallableT&& handler, const char* const* value_arr,
-      const int* size_arr, const int* type_arr, std::size_t num_values) {
+  auto finish(query_view query, ResultCallableT&& handler) {
     assert(!done_);
 
-    const auto res = PQsendQueryPrepared(connection().underlying_handle(),
-        statement_name.c_str(),
-        num_values,
-        value_arr,
-        size_arr,
-        type_arr,
-        1);
+    if (!begun_) {
+      done_ = true;
 
-    if (res != 1) {
-      throw std::runtime_error{
-        "error executing query '" + statement_name + "': " + std::string{connection().last_error_message()}};
+      auto initiation = [this](auto&& handler) {
+        auto& c = connection();
+
+        boost::asio::post(c.get_executor(),
+            [&c, handler = std::move(handler)]() mutable {
+              complete_handler(handler, result_t{PQmakeEmptyPGresult(c.underlying_handle(), PGRES_COMMAND_OK)});
+            });
+      };
+
+      return boost::asio::async_initiate<
+        ResultCallableT, void(result_t)>(
+            initiation, handler);
     }
 
+    this->send_query_params(query);
+    done_ = true;
+
     return this->handle_exec(std::forward<ResultCallableT>(handler));
   }
 
 private:
   std::reference_wrapper<connection_t> c_;
   bool done_;
+
+  /// Whether BEGIN has been sent.
+  bool begun_;
 };
 
 }
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "result.hpp"
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace postgrespp {
+
+template <class>
+class batch_operation;
+
+/**
+ * The aggregate result of executing a statement with many parameter sets,
+ * see \ref basic_transaction::async_exec_batch.
+ */
+class batch_result {
+  template <class>
+  friend class batch_operation;
+public:
+  using size_type = std::size_t;
+
+  /// The \ref error_index() of a statement that could not be prepared.
+  static constexpr size_type npos = std::numeric_limits<size_type>::max();
+
+public:
+  explicit batch_result(size_type size)
+    : affected_rows_(size) {
+  }
+
+  /// True if the statement succeeded with every parameter set.
+  bool ok() const { return error_.done(); }
+
+  /// Number of parameter sets.
+  size_type size() const { return affected_rows_.size(); }
+
+  /**
+   * Rows affected by the statement with each parameter set, in order.
+   * 0 for those that failed or were not executed because of an earlier
+   * error.
+   */
+  const std::vector<size_type>& affected_rows() const { return affected_rows_; }
+
+  /**
+   * Index of the parameter set the statement failed with first, or
+   * \ref npos if it could not be prepared. Must not be used if \ref ok().
+   */
+  size_type error_index() const { return error_index_; }
+
+  /// The result of the first error. Must not be used if \ref ok().
+  const result& error() const { return error_; }
+
+private:
+  void set_error(size_type index, result&& res) {
+    if (!ok())
+      return;
+
+    error_index_ = index;
+    error_ = std::move(res);
+  }
+
+private:
+  std::vector<size_type> affected_rows_;
+  size_type error_index_ = npos;
+  result error_{nullptr};
+};
+
+}
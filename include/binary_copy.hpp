@@ -0,0 +1,281 @@
+#pragma once
+
+#include "type_decoder.hpp"
+#include "type_encoder.hpp"
+
+#include <boost/endian/conversion.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace postgrespp { namespace binary_copy {
+
+/// The signature every binary COPY stream starts with.
+constexpr char signature[] = "PGCOPY\n\377\r\n";
+constexpr std::size_t signature_size = sizeof(signature);
+
+template <class T>
+struct is_optional : std::false_type {
+};
+
+template <class T>
+struct is_optional<std::optional<T>> : std::true_type {
+};
+
+template <class T>
+void append_big_endian(std::string& buf, T value) {
+  const auto big = boost::endian::native_to_big(value);
+  buf.append(reinterpret_cast<const char*>(&big), sizeof(big));
+}
+
+/// Appends the signature, flags and an empty header extension.
+inline void append_header(std::string& buf) {
+  buf.append(signature, signature_size);
+  append_big_endian<std::int32_t>(buf, 0);
+  append_big_endian<std::int32_t>(buf, 0);
+}
+
+inline void append_trailer(std::string& buf) {
+  append_big_endian<std::int16_t>(buf, -1);
+}
+
+/**
+ * Appends the length and the binary representation of \p param.
+ * Empty std::optional values and std::nullopt are appended as NULL.
+ */
+template <class Param>
+void append_field(std::string& buf, Param&& param) {
+  using param_t = std::remove_cv_t<std::remove_reference_t<Param>>;
+
+  if constexpr (std::is_same_v<param_t, std::nullopt_t>) {
+    append_big_endian<std::int32_t>(buf, -1);
+  } else if constexpr (is_optional<param_t>::value) {
+    if (param)
+      append_field(buf, *param);
+    else
+      append_big_endian<std::int32_t>(buf, -1);
+  } else {
+    using encoder_t = typename type_encoder<const param_t&>::encoder_t;
+    using value_t = typename encoder_t::value_t;
+
+    const value_t value = encoder_t{}.to_text_value(param);
+    const auto size = encoder_t{}.size(param);
+
+    append_big_endian<std::int32_t>(buf, static_cast<std::int32_t>(size));
+    buf.append(typename type_encoder<const value_t&>::encoder_t{}.c_str(value), size);
+  }
+}
+
+/**
+ * Appends a tuple. Parameters are encoded in binary format, so their types
+ * must match the types of the columns.
+ */
+template <class... Params>
+void append_row(std::string& buf, Params&&... params) {
+  append_big_endian<std::int16_t>(buf, sizeof...(Params));
+  (append_field(buf, std::forward<Params>(params)), ...);
+}
+
+template <class T>
+T load_big_endian(const char* data) {
+  using namespace boost::endian;
+
+  return endian_load<T, sizeof(T), order::big>(reinterpret_cast<unsigned const char*>(data));
+}
+
+/**
+ * A field of a row in binary COPY format. It refers to the data of the row
+ * and must not outlive it.
+ */
+class field {
+public:
+  field(const char* data, std::int32_t length)
+    : data_{length < 0 ? "" : data}
+    , length_{length} {
+  }
+
+  /// Decodes the field the same way as \ref postgrespp::field::as().
+  template <class T>
+  T as() const {
+    using decoder_t = type_decoder<T>;
+
+    if (!decoder_t::nullable && is_null())
+      throw std::length_error{"field is null"};
+
+    const auto field_length = size();
+    if (!(field_length == 0 && decoder_t::nullable) &&
+        (field_length < decoder_t::min_size || field_length > decoder_t::max_size))
+      throw std::length_error{"field length " + std::to_string(field_length) + " not in range " +
+        std::to_string(decoder_t::min_size) + "-" +
+        std::to_string(decoder_t::max_size)};
+
+    return unsafe_as<T>();
+  }
+
+  template <class T>
+  T as(T&& default_value) const {
+    if (is_null())
+      return std::forward<T>(default_value);
+    else
+      return as<T>();
+  }
+
+  template <class T>
+  T unsafe_as() const {
+    return type_decoder<T>{}.from_binary(data_, size());
+  }
+
+  bool is_null() const { return length_ < 0; }
+
+  const char* data() const { return data_; }
+
+  std::size_t size() const { return is_null() ? 0 : static_cast<std::size_t>(length_); }
+
+private:
+  const char* data_;
+  std::int32_t length_;
+};
+
+/**
+ * A row in binary COPY format as returned by PQgetCopyData. It does not own
+ * the data and its fields are decoded in place.
+ */
+class row {
+public:
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = field;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const field*;
+    using reference = field;
+
+  public:
+    explicit const_iterator(const char* pos)
+      : pos_{pos} {
+    }
+
+    field operator*() const {
+      const auto length = load_big_endian<std::int32_t>(pos_);
+
+      return {pos_ + sizeof(length), length};
+    }
+
+    const_iterator& operator++() {
+      const auto length = load_big_endian<std::int32_t>(pos_);
+
+      pos_ += sizeof(length) + (length < 0 ? 0 : length);
+
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      auto ret = *this;
+      ++*this;
+      return ret;
+    }
+
+    bool operator==(const const_iterator& rhs) const { return pos_ == rhs.pos_; }
+    bool operator!=(const const_iterator& rhs) const { return pos_ != rhs.pos_; }
+
+  private:
+    const char* pos_;
+  };
+
+public:
+  /**
+   * \p data a tuple without the file header and trailer.
+   * Throws if the field lengths do not add up to \p length.
+   */
+  row(const char* data, std::size_t length)
+    : begin_{data + sizeof(std::int16_t)}
+    , end_{data + length} {
+    if (length < sizeof(std::int16_t))
+      throw std::length_error{"malformed COPY row"};
+
+    size_ = static_cast<std::size_t>(load_big_endian<std::int16_t>(data));
+
+    const char* pos = begin_;
+    for (std::size_t i = 0; i < size_; ++i) {
+      if (end_ - pos < static_cast<std::ptrdiff_t>(sizeof(std::int32_t)))
+        throw std::length_error{"malformed COPY row"};
+
+      const auto field_length = load_big_endian<std::int32_t>(pos);
+      pos += sizeof(field_length);
+
+      if (field_length > 0) {
+        if (end_ - pos < field_length)
+          throw std::length_error{"malformed COPY row"};
+
+        pos += field_length;
+      }
+    }
+
+    if (pos != end_)
+      throw std::length_error{"malformed COPY row"};
+  }
+
+  std::size_t size() const { return size_; }
+
+  const_iterator begin() const { return const_iterator{begin_}; }
+  const_iterator end() const { return const_iterator{end_}; }
+
+  /**
+   * Decodes the fields in order into a tuple of \p Ts.
+   * Throws if the row does not have exactly sizeof...(Ts) fields.
+   */
+  template <class... Ts>
+  std::tuple<Ts...> as() const {
+    if (size_ != sizeof...(Ts))
+      throw std::length_error{"row has " + std::to_string(size_) + " fields, expected " +
+        std::to_string(sizeof...(Ts))};
+
+    auto it = begin();
+
+    // Braced initialization is evaluated in order.
+    return std::tuple<Ts...>{decode_next<Ts>(it)...};
+  }
+
+private:
+  template <class T>
+  static T decode_next(const_iterator& it) {
+    return (*it++).template as<T>();
+  }
+
+private:
+  const char* begin_;
+  const char* end_;
+  std::size_t size_;
+};
+
+/**
+ * Returns the size of the file header at the start of \p data, or 0 if
+ * \p data does not start with one.
+ */
+inline std::size_t header_size(const char* data, std::size_t length) {
+  constexpr auto fixed_size = signature_size + 2 * sizeof(std::int32_t);
+
+  if (length < fixed_size || std::memcmp(data, signature, signature_size) != 0)
+    return 0;
+
+  const auto extension_length = load_big_endian<std::int32_t>(data + signature_size + sizeof(std::int32_t));
+
+  if (extension_length < 0 || length - fixed_size < static_cast<std::size_t>(extension_length))
+    throw std::length_error{"malformed COPY header"};
+
+  return fixed_size + extension_length;
+}
+
+/// Returns true if \p data is the file trailer.
+inline bool is_trailer(const char* data, std::size_t length) {
+  return length == sizeof(std::int16_t) && load_big_endian<std::int16_t>(data) == -1;
+}
+
+}}
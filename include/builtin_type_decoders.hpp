@@ -1,5 +1,7 @@
 #pragma once
 
+#include "byteswap.hpp"
+
 #include <boost/endian/buffers.hpp>
 
 #include <string>
@@ -20,6 +22,11 @@ public:
 
     return endian_load<T, sizeof(T), order::big>(reinterpret_cast<unsigned const char*>(data));
   }
+
+  /// Converts \p n values copied as they are from binary fields in place.
+  static void from_binary_inplace(T* values, std::size_t n) {
+    byteswap::big_to_native_inplace(values, n);
+  }
 };
 
 template <>
@@ -61,6 +68,11 @@ public:
 
     return endian_load<T, sizeof(T), order::big>(reinterpret_cast<unsigned const char*>(data));
   }
+
+  /// Converts \p n values copied as they are from binary fields in place.
+  static void from_binary_inplace(T* values, std::size_t n) {
+    byteswap::big_to_native_inplace(values, n);
+  }
 };
 
 }
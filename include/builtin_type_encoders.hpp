@@ -21,7 +21,7 @@ public:
   }
 
   static constexpr int type(const std::string& t) {
-    return static_cast<int>(field_type::TEXT);
+    return static_cast<int>(field_type::BINARY);
   }
 
   value_t to_text_value(const std::string& t) {
@@ -45,7 +45,7 @@ public:
   }
 
   static constexpr int type(const char* const& t) {
-    return static_cast<int>(field_type::TEXT);
+    return static_cast<int>(field_type::BINARY);
   }
 
   value_t to_text_value(const char* const& t) {
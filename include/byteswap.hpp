@@ -0,0 +1,121 @@
+#pragma once
+
+#include <boost/endian/conversion.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace postgrespp { namespace byteswap {
+
+namespace detail {
+
+template <std::size_t Size>
+struct uint_of_size;
+
+template <>
+struct uint_of_size<2> {
+  using type = std::uint16_t;
+};
+
+template <>
+struct uint_of_size<4> {
+  using type = std::uint32_t;
+};
+
+template <>
+struct uint_of_size<8> {
+  using type = std::uint64_t;
+};
+
+template <std::size_t Size>
+void reverse_scalar(unsigned char* data, std::size_t n) {
+  using uint_t = typename uint_of_size<Size>::type;
+
+  for (std::size_t i = 0; i < n; ++i, data += Size) {
+    uint_t v;
+    std::memcpy(&v, data, Size);
+    boost::endian::endian_reverse_inplace(v);
+    std::memcpy(data, &v, Size);
+  }
+}
+
+#if defined(__SSSE3__)
+
+template <std::size_t Size>
+__m128i reverse_mask() {
+  if constexpr (Size == 2)
+    return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+  else if constexpr (Size == 4)
+    return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  else
+    return _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+}
+
+template <std::size_t Size>
+__m128i reverse_vector(__m128i v) {
+  return _mm_shuffle_epi8(v, reverse_mask<Size>());
+}
+
+#elif defined(__SSE2__)
+
+template <std::size_t Size>
+__m128i reverse_vector(__m128i v) {
+  // Reorder the 16-bit words within each value, then swap the bytes of each
+  // word.
+  if constexpr (Size == 4) {
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+  } else if constexpr (Size == 8) {
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+  }
+
+  return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+#endif
+
+}
+
+/**
+ * Reverses the byte order of each of the \p n values of \p Size bytes at
+ * \p data in place. Uses SSSE3 or SSE2 when enabled at compile time.
+ */
+template <std::size_t Size>
+void reverse_inplace(void* data, std::size_t n) {
+  static_assert(Size == 2 || Size == 4 || Size == 8, "unsupported size");
+
+  auto bytes = static_cast<unsigned char*>(data);
+
+#if defined(__SSSE3__) || defined(__SSE2__)
+  constexpr std::size_t per_vector = 16 / Size;
+
+  for (; n >= per_vector; n -= per_vector, bytes += 16) {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(bytes), detail::reverse_vector<Size>(v));
+  }
+#endif
+
+  detail::reverse_scalar<Size>(bytes, n);
+}
+
+/**
+ * Converts \p n big endian values of arithmetic type \p T at \p data to native
+ * byte order in place.
+ */
+template <class T>
+void big_to_native_inplace(T* data, std::size_t n) {
+  static_assert(std::is_arithmetic_v<T>, "expected arithmetic type");
+
+  if constexpr (sizeof(T) > 1 && boost::endian::order::native == boost::endian::order::little)
+    reverse_inplace<sizeof(T)>(data, n);
+}
+
+}}
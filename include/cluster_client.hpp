@@ -0,0 +1,96 @@
+#pragma once
+
+#include "connection_pool.hpp"
+#include "transaction_mode.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace postgrespp {
+
+/**
+ * Holds a \ref connection_pool to a primary server and one to each of its
+ * read replicas, and routes work between them: connections for read-only
+ * transactions are acquired from the replica with the fewest connections
+ * lent out, all others from the primary.
+ *
+ * The client must outlive all of its operations and connections.
+ */
+class cluster_client {
+public:
+  using executor_type = connection_pool::executor_type;
+  using pool_t = connection_pool;
+
+  struct options {
+    /// Options of the pool to the primary.
+    pool_t::options primary;
+
+    /// Options of the pool to each replica.
+    pool_t::options replica;
+  };
+
+public:
+  cluster_client(const executor_type& exc, std::string primary_conninfo,
+      const std::vector<std::string>& replica_conninfos, options opts);
+
+  cluster_client(const executor_type& exc, std::string primary_conninfo,
+      const std::vector<std::string>& replica_conninfos)
+    : cluster_client{exc, std::move(primary_conninfo), replica_conninfos, options{}} {
+  }
+
+  template <class ExecutionContextT,
+           class = std::enable_if_t<std::is_convertible_v<ExecutionContextT&, boost::asio::execution_context&>>>
+  cluster_client(ExecutionContextT& ctx, std::string primary_conninfo,
+      const std::vector<std::string>& replica_conninfos, options opts = {})
+    : cluster_client{ctx.get_executor(), std::move(primary_conninfo), replica_conninfos, opts} {
+  }
+
+  cluster_client(const cluster_client&) = delete;
+  cluster_client& operator=(const cluster_client&) = delete;
+
+  /**
+   * Acquires a connection asynchronously for a transaction of \p RWT, see
+   * \ref connection_pool::async_acquire(). A \ref read_only transaction gets a
+   * connection to the least loaded replica, or to the primary if there are
+   * no replicas; any other gets a connection to the primary.
+   *
+   * \code
+   * client.async_acquire<read_only>([](auto&& ec, pooled_connection c) {
+   *   c->async_transaction<read_only>(...);
+   * });
+   * \endcode
+   */
+  template <class RWT = read_write, class CompletionTokenT>
+  auto async_acquire(CompletionTokenT&& handler) {
+    auto& pool = is_read_only_v<RWT> ? replica_for_read() : primary();
+
+    return pool.async_acquire(std::forward<CompletionTokenT>(handler));
+  }
+
+  pool_t& primary() { return *primary_; }
+
+  std::size_t replica_count() const { return replicas_.size(); }
+
+  pool_t& replica(std::size_t i) { return *replicas_.at(i); }
+
+  executor_type get_executor() const { return primary_->get_executor(); }
+
+private:
+  /**
+   * Returns the replica with the fewest connections lent out. Ties are
+   * broken in turn so that an idle cluster spreads its first connections.
+   */
+  pool_t& replica_for_read();
+
+private:
+  std::unique_ptr<pool_t> primary_;
+  std::vector<std::unique_ptr<pool_t>> replicas_;
+
+  std::atomic<std::size_t> next_replica_{0};
+};
+
+}
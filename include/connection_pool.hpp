@@ -0,0 +1,239 @@
+#pragma once
+
+#include "basic_connection.hpp"
+#include "error.hpp"
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace postgrespp {
+
+class connection_pool;
+
+/**
+ * A connection borrowed from a \ref connection_pool. The connection is
+ * returned to the pool when this object is destructed or \ref release() is
+ * called.
+ */
+class pooled_connection {
+public:
+  using connection_t = basic_connection;
+
+public:
+  pooled_connection() = default;
+
+  pooled_connection(connection_pool& pool, std::unique_ptr<connection_t> c);
+
+  pooled_connection(const pooled_connection&) = delete;
+  pooled_connection(pooled_connection&& rhs) noexcept = default;
+
+  pooled_connection& operator=(const pooled_connection&) = delete;
+  pooled_connection& operator=(pooled_connection&& rhs) noexcept {
+    using std::swap;
+
+    swap(pool_, rhs.pool_);
+    swap(c_, rhs.c_);
+
+    return *this;
+  }
+
+  ~pooled_connection() {
+    release();
+  }
+
+  /**
+   * Returns the connection to the pool. The connection must not have any
+   * operation in progress.
+   */
+  void release();
+
+  connection_t& operator*() { return *c_; }
+
+  connection_t* operator->() { return c_.get(); }
+
+  explicit operator bool() const { return c_ != nullptr; }
+
+private:
+  connection_pool* pool_ = nullptr;
+  std::unique_ptr<connection_t> c_;
+};
+
+/**
+ * Owns a set of connections to the same server and lends them out.
+ *
+ * A connection is bound to the executor of the operation that caused it to
+ * be created and is only ever handed out again to operations with the same
+ * associated executor, so its handlers keep running on the same strand. The
+ * book-keeping of the pool runs on its own strand and connections are
+ * established asynchronously, so neither blocks.
+ *
+ * The pool must outlive all of its operations and connections.
+ */
+class connection_pool {
+  friend class pooled_connection;
+public:
+  using connection_t = basic_connection;
+  using executor_type = boost::asio::any_io_executor;
+  using error_code_t = boost::system::error_code;
+
+  struct options {
+    /// Number of connections to start opening when the pool is constructed.
+    std::size_t min_size = 0;
+
+    /// Maximum number of connections that are open at the same time.
+    std::size_t max_size = 1;
+
+    /// Maximum number of \ref async_acquire() calls waiting for a connection.
+    std::size_t max_waiting = std::numeric_limits<std::size_t>::max();
+  };
+
+public:
+  connection_pool(const executor_type& exc, std::string pgconninfo, options opts);
+
+  connection_pool(const executor_type& exc, std::string pgconninfo)
+    : connection_pool{exc, std::move(pgconninfo), options{}} {
+  }
+
+  template <class ExecutionContextT,
+           class = std::enable_if_t<std::is_convertible_v<ExecutionContextT&, boost::asio::execution_context&>>>
+  connection_pool(ExecutionContextT& ctx, std::string pgconninfo, options opts = {})
+    : connection_pool{ctx.get_executor(), std::move(pgconninfo), opts} {
+  }
+
+  connection_pool(const connection_pool&) = delete;
+  connection_pool& operator=(const connection_pool&) = delete;
+
+  /**
+   * Acquires a connection asynchronously.
+   * \p handler is called with a \ref pooled_connection on the executor
+   * associated with it, which defaults to the executor of the pool.
+   *
+   * If all connections are in use and the pool cannot grow, the operation
+   * waits for a connection to be released. It fails with
+   * \ref error::too_many_waiters if \ref options::max_waiting operations are
+   * already waiting and with \ref error::connection_failed if a new
+   * connection could not be established.
+   */
+  template <class CompletionTokenT>
+  auto async_acquire(CompletionTokenT&& handler) {
+    auto initiation = [this](auto&& handler) {
+      using handler_t = std::decay_t<decltype(handler)>;
+
+      acquire(std::make_unique<acquire_operation_impl<handler_t>>(
+            handler_executor(handler), std::move(handler)));
+    };
+
+    return boost::asio::async_initiate<
+      CompletionTokenT, void(error_code_t, pooled_connection)>(
+          initiation, handler);
+  }
+
+  executor_type get_executor() const { return exc_; }
+
+  /**
+   * Number of connections lent out and not released yet. It may be read
+   * from any thread.
+   */
+  std::size_t lent() const { return lent_.load(std::memory_order_relaxed); }
+
+private:
+  class acquire_operation {
+  public:
+    explicit acquire_operation(const executor_type& exc)
+      : exc_{exc} {
+    }
+
+    virtual ~acquire_operation() = default;
+
+    /// Posts the handler to its executor.
+    virtual void complete(const error_code_t& ec, pooled_connection c) = 0;
+
+    const executor_type& get_executor() const { return exc_; }
+
+  private:
+    executor_type exc_;
+  };
+
+  template <class HandlerT>
+  class acquire_operation_impl : public acquire_operation {
+  public:
+    acquire_operation_impl(const executor_type& exc, HandlerT&& handler)
+      : acquire_operation{exc}
+      , handler_{std::move(handler)} {
+    }
+
+    void complete(const error_code_t& ec, pooled_connection c) override {
+      boost::asio::post(get_executor(),
+          [handler = std::move(handler_), ec, c = std::move(c)]() mutable {
+            handler(ec, std::move(c));
+          });
+    }
+
+  private:
+    HandlerT handler_;
+  };
+
+  using acquire_operation_ptr = std::unique_ptr<acquire_operation>;
+
+private:
+  /**
+   * Returns the executor associated with \p handler or the executor of the
+   * pool if the associated one cannot run connections.
+   */
+  template <class HandlerT>
+  executor_type handler_executor(const HandlerT& handler) const {
+    using associated_t = boost::asio::associated_executor_t<HandlerT, executor_type>;
+
+    if constexpr (std::is_convertible_v<associated_t, executor_type>) {
+      return boost::asio::get_associated_executor(handler, exc_);
+    } else {
+      return exc_;
+    }
+  }
+
+  void acquire(acquire_operation_ptr op);
+
+  void release(std::unique_ptr<connection_t> c);
+
+  void do_acquire(acquire_operation_ptr op);
+
+  void do_release(std::unique_ptr<connection_t> c);
+
+  /// Opens a new connection on the executor of \p op and completes it.
+  void open(acquire_operation_ptr op);
+
+  void on_open_failed();
+
+  /// Closes \p c on its own executor.
+  void close(std::unique_ptr<connection_t> c);
+
+  bool reusable(connection_t& c) const;
+
+private:
+  executor_type exc_;
+  boost::asio::strand<executor_type> strand_;
+  const std::string pgconninfo_;
+  const options opts_;
+
+  std::vector<std::unique_ptr<connection_t>> idle_;
+  std::deque<acquire_operation_ptr> waiting_;
+
+  /// Number of open connections, including those being opened.
+  std::size_t size_ = 0;
+
+  std::atomic<std::size_t> lent_{0};
+};
+
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "binary_copy.hpp"
+#include "error.hpp"
+#include "socket_operations.hpp"
+
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/post.hpp>
+
+#include <libpq-fe.h>
+
+#include <functional>
+#include <string>
+#include <utility>
+
+namespace postgrespp {
+
+class basic_connection;
+
+/**
+ * Writes rows in binary COPY format to a connection in COPY IN mode.
+ * See \ref basic_transaction::async_copy_in.
+ *
+ * Rows are buffered by \ref write_row() and sent by \ref async_flush() and
+ * \ref async_finish(). The writer must not be moved while one of those is in
+ * progress.
+ */
+template <class ConnectionT>
+class basic_copy_in_writer : public socket_operations<basic_copy_in_writer<ConnectionT>> {
+  friend class socket_operations<basic_copy_in_writer<ConnectionT>>;
+public:
+  using connection_t = ConnectionT;
+  using error_code_t = boost::system::error_code;
+
+private:
+  using result_t = typename socket_operations<basic_copy_in_writer<ConnectionT>>::result_t;
+
+public:
+  explicit basic_copy_in_writer(connection_t& c)
+    : c_{c} {
+    binary_copy::append_header(buf_);
+  }
+
+  /**
+   * Encodes a row into the buffer. \p params are encoded in binary format,
+   * so their types must match the types of the columns. Use std::optional or
+   * std::nullopt for NULL.
+   */
+  template <class... Params>
+  void write_row(Params&&... params) {
+    binary_copy::append_row(buf_, std::forward<Params>(params)...);
+  }
+
+  /// Size of the data buffered by \ref write_row() that has not been sent yet.
+  std::size_t buffered_size() const { return buf_.size(); }
+
+  /**
+   * Sends the buffered rows. \p handler is called with an error code once
+   * the connection has accepted all of them. Waiting for it before writing
+   * more rows bounds the memory used by the buffers.
+   */
+  template <class CompletionTokenT>
+  auto async_flush(CompletionTokenT&& handler) {
+    auto initiation = [this](auto&& handler) {
+      flush(std::move(handler), true);
+    };
+
+    return boost::asio::async_initiate<
+      CompletionTokenT, void(error_code_t)>(
+          initiation, handler);
+  }
+
+  /**
+   * Sends the remaining rows and ends the copy. \p handler is called with the
+   * result of the COPY statement.
+   */
+  template <class ResultCallableT>
+  auto async_finish(ResultCallableT&& handler) {
+    auto initiation = [this](auto&& handler) {
+      binary_copy::append_trailer(buf_);
+
+      flush([this, handler = std::move(handler)](const error_code_t& ec) mutable {
+            if (ec == error::copy_failed) {
+              complete_handler(handler, result_t{PQmakeEmptyPGresult(connection().underlying_handle(), PGRES_FATAL_ERROR)});
+            } else if (ec) {
+              // The socket could not be waited for; the connection may be gone.
+              complete_handler(handler, result_t::make_error(ec));
+            } else {
+              end_copy(std::move(handler));
+            }
+          }, true);
+    };
+
+    return boost::asio::async_initiate<
+      ResultCallableT, void(result_t)>(
+          initiation, handler);
+  }
+
+protected:
+  connection_t& connection() { return c_.get(); }
+
+private:
+  /**
+   * Hands the buffered data to libpq and flushes it, waiting for the socket
+   * to become writable as needed. \p initiating must be true when called from
+   * an initiating function so that \p handler is not called from there.
+   */
+  template <class HandlerT>
+  void flush(HandlerT&& handler, bool initiating) {
+    const auto conn = connection().underlying_handle();
+
+    if (!buf_.empty()) {
+      const auto res = PQputCopyData(conn, buf_.data(), static_cast<int>(buf_.size()));
+
+      if (res == 1) {
+        buf_.clear();
+      } else if (res == -1) {
+        complete(std::move(handler), error::copy_failed, initiating);
+        return;
+      }
+    }
+
+    if (buf_.empty()) {
+      const auto res = PQflush(conn);
+
+      if (res == 0) {
+        complete(std::move(handler), error_code_t{}, initiating);
+        return;
+      } else if (res == -1) {
+        complete(std::move(handler), error::copy_failed, initiating);
+        return;
+      }
+    }
+
+    wait_write_ready([this, handler = std::move(handler)](const error_code_t& ec) mutable {
+          if (ec) {
+            complete(std::move(handler), ec, false);
+          } else {
+            flush(std::move(handler), false);
+          }
+        });
+  }
+
+  template <class ResultCallableT>
+  void end_copy(ResultCallableT&& handler) {
+    const auto res = PQputCopyEnd(connection().underlying_handle(), nullptr);
+
+    if (res == 0) {
+      wait_write_ready([this, handler = std::move(handler)](const error_code_t& ec) mutable {
+            if (ec) {
+              complete_handler(handler, result_t::make_error(ec));
+            } else {
+              end_copy(std::move(handler));
+            }
+          });
+    } else if (res == -1) {
+      complete_handler(handler, result_t{PQmakeEmptyPGresult(connection().underlying_handle(), PGRES_FATAL_ERROR)});
+    } else {
+      this->handle_exec(std::move(handler));
+    }
+  }
+
+  template <class HandlerT>
+  void wait_write_ready(HandlerT&& handler) {
+    auto& socket = connection().socket();
+
+    socket.async_wait(std::decay_t<decltype(socket)>::wait_write, std::move(handler));
+  }
+
+  /// Calls \p handler with \p ec on its associated executor.
+  template <class HandlerT>
+  void complete(HandlerT&& handler, const error_code_t& ec, bool initiating) {
+    if (initiating) {
+      const auto exc = boost::asio::get_associated_executor(handler, connection().get_executor());
+
+      boost::asio::post(exc, [handler = std::move(handler), ec]() mutable {
+            handler(ec);
+          });
+    } else {
+      complete_handler(handler, ec);
+    }
+  }
+
+private:
+  std::reference_wrapper<connection_t> c_;
+  std::string buf_;
+};
+
+using copy_in_writer = basic_copy_in_writer<basic_connection>;
+
+}
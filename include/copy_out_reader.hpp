@@ -0,0 +1,173 @@
+#pragma once
+
+#include "binary_copy.hpp"
+#include "socket_operations.hpp"
+
+#include <libpq-fe.h>
+
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/error.hpp>
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace postgrespp {
+
+/**
+ * Reads the rows of a connection in COPY OUT mode in binary COPY format.
+ * See \ref basic_transaction::async_copy_out.
+ *
+ * Rows are taken from libpq one at a time with PQgetCopyData and decoded in
+ * place, so no PGresult is built for them and at most one row is held on top
+ * of what libpq has read from the socket.
+ */
+template <class ConnectionT, class RowCallableT, class ResultCallableT>
+class basic_copy_out_reader
+  : public socket_operations<basic_copy_out_reader<ConnectionT, RowCallableT, ResultCallableT>> {
+  friend class socket_operations<basic_copy_out_reader<ConnectionT, RowCallableT, ResultCallableT>>;
+public:
+  using connection_t = ConnectionT;
+
+private:
+  using result_t = typename socket_operations<basic_copy_out_reader>::result_t;
+
+  struct copy_data_deleter {
+    void operator()(char* data) const { PQfreemem(data); }
+  };
+
+public:
+  template <class RowHandlerT, class HandlerT>
+  basic_copy_out_reader(connection_t& c, RowHandlerT&& row_handler, HandlerT&& handler)
+    : c_{c}
+    , row_handler_{std::forward<RowHandlerT>(row_handler)}
+    , handler_{std::forward<HandlerT>(handler)} {
+  }
+
+  /**
+   * Continues with the result of the COPY statement: reads the rows if it is
+   * COPY_OUT, otherwise passes \p res to the handler.
+   */
+  void start(result_t&& res) {
+    if (res.status() != result_t::status_t::COPY_OUT) {
+      complete_handler(handler_, std::move(res));
+    } else {
+      read();
+    }
+  }
+
+protected:
+  connection_t& connection() { return c_.get(); }
+
+private:
+  void read() {
+    const auto conn = connection().underlying_handle();
+
+    for (;;) {
+      char* buf = nullptr;
+      const auto length = PQgetCopyData(conn, &buf, 1);
+
+      if (length > 0) {
+        const std::unique_ptr<char, copy_data_deleter> data{buf};
+
+        on_copy_data(data.get(), static_cast<std::size_t>(length));
+      } else if (length == 0) {
+        wait_read_ready();
+        return;
+      } else if (length == -1) {
+        // The copy is done, the result of the COPY statement follows.
+        if (failed_)
+          handle_exec_failed();
+        else
+          this->handle_exec(std::move(handler_));
+        return;
+      } else {
+        fail();
+        return;
+      }
+    }
+  }
+
+  /**
+   * Passes the row in \p data to the row handler. If it is malformed or the
+   * row handler throws, the rest of the copy data is skipped and the handler
+   * gets \ref error::unexpected_result.
+   */
+  void on_copy_data(const char* data, std::size_t length) {
+    if (failed_)
+      return;
+
+    try {
+      on_row_data(data, length);
+    } catch (const std::exception&) {
+      failed_ = true;
+    }
+  }
+
+  void on_row_data(const char* data, std::size_t length) {
+    if (!header_read_) {
+      const auto header_size = binary_copy::header_size(data, length);
+
+      if (header_size == 0)
+        throw std::length_error{"COPY data does not start with the binary header"};
+
+      header_read_ = true;
+      data += header_size;
+      length -= header_size;
+
+      if (length == 0)
+        return;
+    }
+
+    if (binary_copy::is_trailer(data, length))
+      return;
+
+    row_handler_(binary_copy::row{data, length});
+  }
+
+  /**
+   * Consumes the result of the COPY statement after a failed copy and passes
+   * the handler an error instead, unless the statement failed itself.
+   */
+  void handle_exec_failed() {
+    const auto exc = boost::asio::get_associated_executor(handler_);
+
+    this->handle_exec(boost::asio::bind_executor(exc,
+          [handler = std::move(handler_)](result_t res) mutable {
+            handler(res.ok() ? result_t{PQmakeEmptyPGresult(nullptr, PGRES_BAD_RESPONSE)} : std::move(res));
+          }));
+  }
+
+  void wait_read_ready() {
+    auto& socket = connection().socket();
+
+    socket.async_wait(std::decay_t<decltype(socket)>::wait_read,
+        [self = std::move(*this)](const auto& ec) mutable {
+          // The connection may be gone if its socket has been released.
+          if (ec == boost::asio::error::operation_aborted)
+            return;
+
+          if (ec || PQconsumeInput(self.connection().underlying_handle()) != 1) {
+            self.fail();
+          } else {
+            self.read();
+          }
+        });
+  }
+
+  void fail() {
+    complete_handler(handler_, result_t{PQmakeEmptyPGresult(connection().underlying_handle(), PGRES_FATAL_ERROR)});
+  }
+
+private:
+  std::reference_wrapper<connection_t> c_;
+  RowCallableT row_handler_;
+  ResultCallableT handler_;
+  bool header_read_ = false;
+  bool failed_ = false;
+};
+
+}
@@ -0,0 +1,308 @@
+#pragma once
+
+#include "type_decoder.hpp"
+#include "type_oid.hpp"
+
+#include <libpq-fe.h>
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace postgrespp {
+
+namespace detail {
+
+template <class T>
+struct is_tuple : std::false_type {
+};
+
+template <class... Ts>
+struct is_tuple<std::tuple<Ts...>> : std::true_type {
+};
+
+template <class T>
+struct is_optional : std::false_type {
+};
+
+template <class T>
+struct is_optional<std::optional<T>> : std::true_type {
+};
+
+template <class DecoderT, class T, class Enable = void>
+struct has_from_binary_inplace : std::false_type {
+};
+
+template <class DecoderT, class T>
+struct has_from_binary_inplace<DecoderT, T, std::void_t<
+  decltype(DecoderT::from_binary_inplace(std::declval<T*>(), std::size_t{}))>> : std::true_type {
+};
+
+/// Converts to anything, used to count the members of an aggregate.
+struct any_member {
+  template <class T>
+  operator T() const;
+};
+
+template <class T, class... Args>
+auto is_brace_constructible(int) -> decltype(void(T{std::declval<Args>()...}), std::true_type{});
+
+template <class T, class... Args>
+std::false_type is_brace_constructible(...);
+
+template <class T, class... Args>
+constexpr std::size_t member_count() {
+  if constexpr (decltype(is_brace_constructible<T, Args..., any_member>(0))::value)
+    return member_count<T, Args..., any_member>();
+  else
+    return sizeof...(Args);
+}
+
+/// Ties the members of the aggregate \p t.
+template <class T>
+auto tie_members(T& t) {
+  constexpr auto n = member_count<T>();
+
+  if constexpr (n == 1) {
+    auto& [m0] = t;
+    return std::tie(m0);
+  } else if constexpr (n == 2) {
+    auto& [m0, m1] = t;
+    return std::tie(m0, m1);
+  } else if constexpr (n == 3) {
+    auto& [m0, m1, m2] = t;
+    return std::tie(m0, m1, m2);
+  } else if constexpr (n == 4) {
+    auto& [m0, m1, m2, m3] = t;
+    return std::tie(m0, m1, m2, m3);
+  } else if constexpr (n == 5) {
+    auto& [m0, m1, m2, m3, m4] = t;
+    return std::tie(m0, m1, m2, m3, m4);
+  } else if constexpr (n == 6) {
+    auto& [m0, m1, m2, m3, m4, m5] = t;
+    return std::tie(m0, m1, m2, m3, m4, m5);
+  } else if constexpr (n == 7) {
+    auto& [m0, m1, m2, m3, m4, m5, m6] = t;
+    return std::tie(m0, m1, m2, m3, m4, m5, m6);
+  } else if constexpr (n == 8) {
+    auto& [m0, m1, m2, m3, m4, m5, m6, m7] = t;
+    return std::tie(m0, m1, m2, m3, m4, m5, m6, m7);
+  } else if constexpr (n == 9) {
+    auto& [m0, m1, m2, m3, m4, m5, m6, m7, m8] = t;
+    return std::tie(m0, m1, m2, m3, m4, m5, m6, m7, m8);
+  } else if constexpr (n == 10) {
+    auto& [m0, m1, m2, m3, m4, m5, m6, m7, m8, m9] = t;
+    return std::tie(m0, m1, m2, m3, m4, m5, m6, m7, m8, m9);
+  } else if constexpr (n == 11) {
+    auto& [m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10] = t;
+    return std::tie(m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10);
+  } else if constexpr (n == 12) {
+    auto& [m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11] = t;
+    return std::tie(m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11);
+  } else if constexpr (n == 13) {
+    auto& [m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11, m12] = t;
+    return std::tie(m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11, m12);
+  } else if constexpr (n == 14) {
+    auto& [m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11, m12, m13] = t;
+    return std::tie(m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11, m12, m13);
+  } else if constexpr (n == 15) {
+    auto& [m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11, m12, m13, m14] = t;
+    return std::tie(m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11, m12, m13, m14);
+  } else if constexpr (n == 16) {
+    auto& [m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11, m12, m13, m14, m15] = t;
+    return std::tie(m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11, m12, m13, m14, m15);
+  } else {
+    static_assert(n <= 16, "too many members");
+  }
+}
+
+template <class T>
+struct remove_references;
+
+template <class... Ts>
+struct remove_references<std::tuple<Ts...>> {
+  using type = std::tuple<std::remove_reference_t<Ts>...>;
+};
+
+template <class T, class Enable = void>
+struct row_tuple {
+  using type = typename remove_references<decltype(tie_members(std::declval<T&>()))>::type;
+};
+
+template <class T>
+struct row_tuple<T, std::enable_if_t<is_tuple<T>::value>> {
+  using type = T;
+};
+
+}
+
+/**
+ * The std::tuple of the column types of \p T, which is either a std::tuple
+ * or an aggregate with up to 16 members that are not aggregates themselves.
+ */
+template <class T>
+using row_tuple_t = typename detail::row_tuple<T>::type;
+
+/// Validates and decodes a column of type \p T.
+template <class T>
+class column_decoder {
+private:
+  using decoder_t = type_decoder<T>;
+
+public:
+  static constexpr bool fixed_size = decoder_t::min_size == decoder_t::max_size;
+
+public:
+  /**
+   * Throws if column \p col of \p res is not in binary format or its size
+   * does not match the size of \p T.
+   */
+  static void validate(const PGresult* res, int col) {
+    if (PQfformat(res, col) != 1)
+      throw std::runtime_error{"column " + std::to_string(col) + " is not in binary format"};
+
+    if constexpr (fixed_size) {
+      const auto size = PQfsize(res, col);
+
+      if (size != static_cast<int>(decoder_t::max_size))
+        throw std::length_error{"column " + std::to_string(col) + " size " + std::to_string(size) +
+          " does not match " + std::to_string(decoder_t::max_size)};
+    }
+
+    // Numbers of the same size, e.g. int4 and float4, are told apart by type.
+    if constexpr (std::is_arithmetic_v<T> && has_type_oid<T>::value) {
+      const auto type = PQftype(res, col);
+
+      if (type != type_oid_v<T>)
+        throw std::runtime_error{"column " + std::to_string(col) + " type " + std::to_string(type) +
+          " does not match " + std::to_string(type_oid_v<T>)};
+    }
+  }
+
+  /// Decodes a field of a column that has been validated.
+  static T decode(const PGresult* res, int row, int col) {
+    if constexpr (!decoder_t::nullable) {
+      if (PQgetisnull(res, row, col))
+        throw std::length_error{"field is null"};
+    }
+
+    if constexpr (fixed_size)
+      return decoder_t{}.from_binary(PQgetvalue(res, row, col), decoder_t::max_size);
+    else
+      return decoder_t{}.from_binary(PQgetvalue(res, row, col), PQgetlength(res, row, col));
+  }
+
+  /**
+   * Decodes column \p col of \p res into \p out, which must have room for
+   * all rows. NULL fields are decoded as T{} and their bits in \p nulls are
+   * set. Throws if a field is NULL and \p nulls is nullptr.
+   *
+   * Fixed-width numbers are copied as they are and converted in bulk.
+   */
+  static void decode_column(const PGresult* res, int col, T* out, std::vector<bool>* nulls) {
+    validate(res, col);
+
+    const auto rows = PQntuples(res);
+
+    if (nulls)
+      nulls->assign(rows, false);
+
+    for (int row = 0; row < rows; ++row) {
+      if (PQgetisnull(res, row, col)) {
+        if (!nulls)
+          throw std::length_error{"field is null"};
+
+        (*nulls)[row] = true;
+        out[row] = T{};
+      } else if constexpr (bulk) {
+        std::memcpy(&out[row], PQgetvalue(res, row, col), sizeof(T));
+      } else {
+        out[row] = decoder_t{}.from_binary(PQgetvalue(res, row, col), PQgetlength(res, row, col));
+      }
+    }
+
+    if constexpr (bulk)
+      decoder_t::from_binary_inplace(out, rows);
+  }
+
+private:
+  static constexpr bool bulk = detail::has_from_binary_inplace<decoder_t, T>::value;
+};
+
+template <class T>
+class column_decoder<std::optional<T>> {
+private:
+  using underlying_decoder_t = column_decoder<T>;
+
+public:
+  static constexpr bool fixed_size = underlying_decoder_t::fixed_size;
+
+public:
+  static void validate(const PGresult* res, int col) {
+    underlying_decoder_t::validate(res, col);
+  }
+
+  static std::optional<T> decode(const PGresult* res, int row, int col) {
+    if (PQgetisnull(res, row, col))
+      return {};
+    else
+      return underlying_decoder_t::decode(res, row, col);
+  }
+};
+
+/**
+ * Decodes the rows of a result into \p T, a std::tuple or an aggregate of
+ * the column types in order.
+ *
+ * The number, format and sizes of the columns are validated once when the
+ * plan is made, so decoding a row only checks for NULL.
+ */
+template <class T>
+class decoding_plan {
+private:
+  using tuple_t = row_tuple_t<T>;
+  using index_sequence_t = std::make_index_sequence<std::tuple_size_v<tuple_t>>;
+
+public:
+  using size_type = std::size_t;
+  using value_type = T;
+
+public:
+  /// Throws if the columns of \p res do not match \p T.
+  explicit decoding_plan(const PGresult* res)
+    : res_{res} {
+    const auto columns = PQnfields(res_);
+
+    if (columns != static_cast<int>(std::tuple_size_v<tuple_t>))
+      throw std::length_error{"result has " + std::to_string(columns) + " columns, expected " +
+        std::to_string(std::tuple_size_v<tuple_t>)};
+
+    validate(index_sequence_t{});
+  }
+
+  value_type decode(size_type row) const {
+    return decode(static_cast<int>(row), index_sequence_t{});
+  }
+
+private:
+  template <std::size_t... Is>
+  void validate(std::index_sequence<Is...>) const {
+    (column_decoder<std::tuple_element_t<Is, tuple_t>>::validate(res_, Is), ...);
+  }
+
+  template <std::size_t... Is>
+  value_type decode(int row, std::index_sequence<Is...>) const {
+    return value_type{column_decoder<std::tuple_element_t<Is, tuple_t>>::decode(res_, row, Is)...};
+  }
+
+private:
+  const PGresult* res_;
+};
+
+}
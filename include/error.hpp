@@ -0,0 +1,55 @@
+#pragma once
+
+#include <boost/system/error_code.hpp>
+
+#include <type_traits>
+
+namespace postgrespp { namespace error {
+
+enum basic_errors {
+  /// A connection to the server could not be established.
+  connection_failed = 1,
+
+  /// Too many operations are already waiting for a pooled connection.
+  too_many_waiters,
+
+  /// COPY data could not be sent or received.
+  copy_failed,
+
+  /// A cancel request could not be delivered to the server.
+  cancel_failed,
+
+  /**
+   * A query failed without a SQLSTATE, which happens when the connection to
+   * the server is lost.
+   */
+  connection_broken,
+
+  /// A query was not executed because one before it in the pipeline failed.
+  pipeline_aborted,
+
+  /**
+   * A query returned results the operation cannot handle, e.g. several for a
+   * string of statements, or COPY data that is not in binary format.
+   */
+  unexpected_result,
+
+  /// A query did not complete in time, see \ref with_timeout().
+  timed_out,
+};
+
+const boost::system::error_category& get_category();
+
+inline boost::system::error_code make_error_code(basic_errors e) {
+  return {static_cast<int>(e), get_category()};
+}
+
+}}
+
+namespace boost { namespace system {
+
+template <>
+struct is_error_code_enum<::postgrespp::error::basic_errors> : std::true_type {
+};
+
+}}
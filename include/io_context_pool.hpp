@@ -0,0 +1,70 @@
+#pragma once
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace postgrespp {
+
+/**
+ * A set of io_contexts, each run by its own thread. Connections created on
+ * the executors it hands out are spread across the threads, and all the work
+ * of a connection stays on one of them, so no strands are needed.
+ *
+ * \code
+ * io_context_pool contexts{std::thread::hardware_concurrency()};
+ *
+ * connection_pool pool{contexts.get_executor(), "host=127.0.0.1 user=postgres"};
+ * \endcode
+ */
+class io_context_pool {
+public:
+  using io_context_t = boost::asio::io_context;
+  using executor_type = io_context_t::executor_type;
+
+public:
+  /// Starts \p size threads, at least one.
+  explicit io_context_pool(std::size_t size);
+
+  io_context_pool(const io_context_pool&) = delete;
+  io_context_pool& operator=(const io_context_pool&) = delete;
+
+  /// Stops the io_contexts and joins their threads.
+  ~io_context_pool();
+
+  /// Returns the executor of the next io_context, in turn.
+  executor_type get_executor();
+
+  io_context_t& get_io_context(std::size_t i) { return contexts_.at(i).ioc; }
+
+  std::size_t size() const { return contexts_.size(); }
+
+  /**
+   * Lets the io_contexts return once they run out of work. Work that has
+   * been started is completed.
+   */
+  void release();
+
+  /// Stops the io_contexts without waiting for their work to complete.
+  void stop();
+
+  /// Waits for the threads to return.
+  void join();
+
+private:
+  struct context {
+    io_context_t ioc{1};
+    boost::asio::executor_work_guard<executor_type> work{ioc.get_executor()};
+  };
+
+private:
+  std::vector<context> contexts_;
+  std::vector<std::thread> threads_;
+  std::atomic<std::size_t> next_{0};
+};
+
+}
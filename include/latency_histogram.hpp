@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace postgrespp {
+
+/**
+ * Counts durations in buckets that are linear within each power of two, like
+ * an HDR histogram with 16 buckets per power of two: values are kept with a
+ * relative error below 1/16, from 1ns up to about 18 minutes.
+ *
+ * Recording is lock free and can be done from any thread. Reading while
+ * recording gives a count that may miss the values being recorded.
+ */
+class latency_histogram {
+public:
+  using duration = std::chrono::nanoseconds;
+
+  static constexpr unsigned sub_bucket_bits = 4;
+  static constexpr std::uint64_t sub_bucket_count = 1u << sub_bucket_bits;
+
+  /// Larger values are counted in the last bucket.
+  static constexpr unsigned max_bits = 40;
+  static constexpr std::size_t bucket_count = (max_bits - sub_bucket_bits + 1) * sub_bucket_count;
+
+public:
+  latency_histogram() = default;
+
+  latency_histogram(const latency_histogram&) = delete;
+  latency_histogram& operator=(const latency_histogram&) = delete;
+
+  void record(duration d) noexcept {
+    const auto value = d.count() < 0 ? std::uint64_t{0} : static_cast<std::uint64_t>(d.count());
+
+    buckets_[index_of(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+
+    auto max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  std::uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+
+  duration max() const noexcept { return duration{static_cast<duration::rep>(max_.load(std::memory_order_relaxed))}; }
+
+  /**
+   * Returns the value below which \p percent percent of the recorded values
+   * fall, rounded up to the end of their bucket; 0 if nothing is recorded.
+   */
+  duration percentile(double percent) const noexcept {
+    const auto total = count();
+
+    if (total == 0)
+      return duration::zero();
+
+    auto rank = static_cast<std::uint64_t>(percent / 100.0 * static_cast<double>(total) + 0.5);
+    if (rank == 0)
+      rank = 1;
+
+    std::uint64_t seen = 0;
+
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+      seen += buckets_[i].load(std::memory_order_relaxed);
+
+      if (seen >= rank)
+        return std::min(duration{static_cast<duration::rep>(upper_bound_of(i))}, max());
+    }
+
+    return max();
+  }
+
+  void reset() noexcept {
+    for (auto& b : buckets_)
+      b.store(0, std::memory_order_relaxed);
+
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+  static std::size_t index_of(std::uint64_t value) noexcept {
+    if (value < sub_bucket_count)
+      return static_cast<std::size_t>(value);
+
+    const unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(value));
+
+    if (msb >= max_bits)
+      return bucket_count - 1;
+
+    const unsigned shift = msb - sub_bucket_bits;
+
+    return (shift + 1) * sub_bucket_count + static_cast<std::size_t>((value >> shift) - sub_bucket_count);
+  }
+
+  /// The largest value counted in bucket \p index.
+  static std::uint64_t upper_bound_of(std::size_t index) noexcept {
+    if (index < sub_bucket_count)
+      return index;
+
+    const auto shift = index / sub_bucket_count - 1;
+    const auto sub_bucket = index % sub_bucket_count + sub_bucket_count;
+
+    return ((sub_bucket + 1) << shift) - 1;
+  }
+
+private:
+  std::array<std::atomic<std::uint64_t>, bucket_count> buckets_{};
+  std::atomic<std::uint64_t> count_{0};
+  std::atomic<std::uint64_t> max_{0};
+};
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "pending_operation.hpp"
+
+#include <boost/system/error_code.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace postgrespp {
+
+/// An asynchronous notification sent with NOTIFY.
+struct notification {
+  std::string channel;
+  std::string payload;
+
+  /// Process ID of the server process that sent it.
+  int backend_pid;
+};
+
+/// Waits for notifications, see \ref basic_connection::async_wait_notification().
+class notification_waiter {
+public:
+  using ptr = std::unique_ptr<notification_waiter>;
+
+public:
+  virtual ~notification_waiter() = default;
+
+  virtual void complete(const boost::system::error_code& ec,
+      std::vector<notification>&& notifications) = 0;
+};
+
+template <class HandlerT>
+class notification_waiter_impl : public notification_waiter {
+public:
+  explicit notification_waiter_impl(HandlerT&& handler)
+    : handler_{std::move(handler)} {
+  }
+
+  void complete(const boost::system::error_code& ec,
+      std::vector<notification>&& notifications) override {
+    complete_handler(handler_, ec, std::move(notifications));
+  }
+
+private:
+  HandlerT handler_;
+};
+
+}
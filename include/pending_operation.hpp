@@ -0,0 +1,500 @@
+#pragma once
+
+#include "batch_result.hpp"
+#include "recycling_allocator.hpp"
+#include "result.hpp"
+#include "statement_cache.hpp"
+#include "tracing.hpp"
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/system_executor.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace postgrespp {
+
+/**
+ * An operation that has been sent to the server and is waiting for its
+ * results. Connections keep these in the order the queries were sent and
+ * hand every result to the operation at the front.
+ */
+class pending_operation {
+  friend class operation_queue;
+public:
+  struct deleter {
+    void operator()(pending_operation* op) const { op->destroy(); }
+  };
+
+  using ptr = std::unique_ptr<pending_operation, deleter>;
+
+public:
+  /// Called for each result of the query.
+  virtual void on_result(result&& res) = 0;
+
+  /// Called once after the last result of the query has been received.
+  virtual void on_done() = 0;
+
+  /**
+   * Called with an error result when the connection fails before all
+   * results of the query have been received. \ref on_done() follows.
+   */
+  virtual void on_error(result&& res) { on_result(std::move(res)); }
+
+  /**
+   * Called after the last result of each query. Operations that receive the
+   * results of more than one query return true until the last one is done.
+   */
+  virtual bool on_query_done() { return false; }
+
+#ifdef POSTGRESPP_TRACING
+  /// False for operations of queries sent internally, which are not traced.
+  virtual bool traced() const { return true; }
+
+  tracing::query_trace trace;
+#endif
+
+protected:
+  virtual ~pending_operation() = default;
+
+  /// Destroys the operation and frees its memory.
+  virtual void destroy() = 0;
+
+private:
+  pending_operation* next_ = nullptr;
+};
+
+/**
+ * An intrusive FIFO of operations. It owns the operations it holds and does
+ * not allocate.
+ *
+ * Operations are numbered in the order they are pushed, starting at 1, so
+ * that they can be told apart after they have been popped.
+ */
+class operation_queue {
+public:
+  using id_type = std::uint64_t;
+
+public:
+  operation_queue() = default;
+
+  operation_queue(const operation_queue&) = delete;
+  operation_queue(operation_queue&& rhs) noexcept
+    : front_{rhs.front_}
+    , back_{rhs.back_}
+    , pushed_{rhs.pushed_}
+    , popped_{rhs.popped_} {
+    // Operations pushed later keep being numbered after the moved ones.
+    rhs.front_ = rhs.back_ = nullptr;
+    rhs.popped_ = rhs.pushed_;
+  }
+
+  operation_queue& operator=(const operation_queue&) = delete;
+  operation_queue& operator=(operation_queue&& rhs) noexcept {
+    using std::swap;
+
+    swap(front_, rhs.front_);
+    swap(back_, rhs.back_);
+    swap(pushed_, rhs.pushed_);
+    swap(popped_, rhs.popped_);
+
+    return *this;
+  }
+
+  ~operation_queue() {
+    while (!empty())
+      pop();
+  }
+
+  bool empty() const { return front_ == nullptr; }
+
+  pending_operation& front() { return *front_; }
+
+  pending_operation& back() { return *back_; }
+
+  /// The number of the operation at the front. The queue must not be empty.
+  id_type front_id() const { return popped_ + 1; }
+
+  /// The number of the operation pushed last, 0 if there is none.
+  id_type back_id() const { return pushed_; }
+
+  void push(pending_operation::ptr op) {
+    const auto p = op.release();
+
+    if (back_)
+      back_->next_ = p;
+    else
+      front_ = p;
+
+    back_ = p;
+    ++pushed_;
+  }
+
+  pending_operation::ptr pop() {
+    pending_operation::ptr op{front_};
+
+    front_ = front_->next_;
+    if (!front_)
+      back_ = nullptr;
+
+    op->next_ = nullptr;
+    ++popped_;
+
+    return op;
+  }
+
+private:
+  pending_operation* front_ = nullptr;
+  pending_operation* back_ = nullptr;
+  id_type pushed_ = 0;
+  id_type popped_ = 0;
+};
+
+/// Frees \p OperationT with the allocator it was allocated with.
+template <class OperationT, class AllocatorT>
+class allocated_operation final : public OperationT {
+public:
+  template <class... Args>
+  allocated_operation(const AllocatorT& alloc, Args&&... args)
+    : OperationT{std::forward<Args>(args)...}
+    , alloc_{alloc} {
+  }
+
+protected:
+  void destroy() override {
+    using traits_t = typename std::allocator_traits<AllocatorT>::template rebind_traits<allocated_operation>;
+    typename traits_t::allocator_type alloc{alloc_};
+
+    traits_t::destroy(alloc, this);
+    traits_t::deallocate(alloc, this, 1);
+  }
+
+private:
+  AllocatorT alloc_;
+};
+
+/// Creates an \p OperationT from \p args with \p alloc.
+template <class OperationT, class AllocatorT, class... Args>
+pending_operation::ptr allocate_operation(const AllocatorT& alloc, Args&&... args) {
+  using op_t = allocated_operation<OperationT, AllocatorT>;
+  using traits_t = typename std::allocator_traits<AllocatorT>::template rebind_traits<op_t>;
+
+  typename traits_t::allocator_type op_alloc{alloc};
+
+  const auto p = traits_t::allocate(op_alloc, 1);
+
+  try {
+    traits_t::construct(op_alloc, p, alloc, std::forward<Args>(args)...);
+  } catch (...) {
+    traits_t::deallocate(op_alloc, p, 1);
+    throw;
+  }
+
+  return pending_operation::ptr{p};
+}
+
+/**
+ * Creates an \p OperationT from \p handler and \p args with the allocator
+ * associated with \p handler, or with \p recycler if there is none.
+ */
+template <class OperationT, class HandlerT, class... Args>
+pending_operation::ptr make_operation(operation_recycler& recycler,
+    HandlerT&& handler, Args&&... args) {
+  const auto alloc = boost::asio::get_associated_allocator(handler,
+      recycling_allocator<void>{recycler});
+
+  return allocate_operation<OperationT>(alloc,
+      std::forward<HandlerT>(handler), std::forward<Args>(args)...);
+}
+
+/**
+ * Calls \p handler with \p args on the executor associated with it, which
+ * may be another strand or thread than the one of the connection. Handlers
+ * without an associated executor are called directly, on the executor of the
+ * connection that received the results.
+ */
+template <class HandlerT, class... Args>
+void complete_handler(HandlerT& handler, Args&&... args) {
+  using executor_t = boost::asio::associated_executor_t<HandlerT>;
+
+  if constexpr (std::is_same_v<executor_t, boost::asio::system_executor>) {
+    handler(std::forward<Args>(args)...);
+  } else {
+    const auto exc = boost::asio::get_associated_executor(handler);
+
+    boost::asio::dispatch(exc,
+        [handler = std::move(handler), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+          std::apply(handler, std::move(args));
+        });
+  }
+}
+
+/**
+ * Stores \p res in \p stored for an operation that expects a single result.
+ * A query that returns more, e.g. a string of statements, keeps the first
+ * error, or is failed with \ref error::unexpected_result if there is none.
+ */
+inline void store_single_result(result& stored, result&& res) {
+  if (stored.done()) {
+    stored = std::move(res);
+  } else if (stored.ok()) {
+    stored = res.ok() ? result{PQmakeEmptyPGresult(nullptr, PGRES_BAD_RESPONSE)} : std::move(res);
+  }
+}
+
+/// Expects a single result and passes it to the handler once done.
+template <class ResultCallableT>
+class exec_operation : public pending_operation {
+public:
+  template <class HandlerT>
+  explicit exec_operation(HandlerT&& handler)
+    : handler_{std::forward<HandlerT>(handler)} {
+  }
+
+  void on_result(result&& res) override {
+    store_single_result(res_, std::move(res));
+  }
+
+  void on_error(result&& res) override {
+    res_ = std::move(res);
+  }
+
+  void on_done() override {
+    complete_handler(handler_, std::move(res_));
+  }
+
+private:
+  ResultCallableT handler_;
+  result res_{nullptr};
+};
+
+/**
+ * Like \ref exec_operation, for a statement that is prepared right before by
+ * a \ref statement_prepare_operation. If preparing fails, the handler gets
+ * that error instead of the result of the execution, which is then aborted.
+ */
+template <class ResultCallableT>
+class prepared_exec_operation : public pending_operation {
+public:
+  template <class HandlerT>
+  explicit prepared_exec_operation(HandlerT&& handler)
+    : handler_{std::forward<HandlerT>(handler)} {
+  }
+
+  void on_result(result&& res) override {
+    store_single_result(res_, std::move(res));
+  }
+
+  void on_error(result&& res) override {
+    res_ = std::move(res);
+  }
+
+  void on_done() override {
+    complete_handler(handler_, prepare_error_.done() ? std::move(res_) : std::move(prepare_error_));
+  }
+
+  result& prepare_error() { return prepare_error_; }
+
+private:
+  ResultCallableT handler_;
+  result res_{nullptr};
+  result prepare_error_{nullptr};
+};
+
+/**
+ * Expects the result of preparing a statement of a \ref statement_cache.
+ * If it fails, the statement is removed from the cache and the error is
+ * stored in \p error.
+ */
+class statement_prepare_operation : public pending_operation {
+public:
+  statement_prepare_operation(statement_cache& cache, std::string name, result& error)
+    : cache_{cache}
+    , name_{std::move(name)}
+    , error_{error} {
+  }
+
+  void on_result(result&& res) override {
+    if (res.status() != result::status_t::COMMAND_OK) {
+      cache_.erase(name_);
+      error_ = std::move(res);
+    }
+  }
+
+  void on_done() override {}
+
+#ifdef POSTGRESPP_TRACING
+  bool traced() const override { return false; }
+#endif
+
+private:
+  statement_cache& cache_;
+  std::string name_;
+  result& error_;
+};
+
+/// Ignores the results of a query that has been sent internally.
+class discard_operation : public pending_operation {
+public:
+  void on_result(result&&) override {}
+
+  void on_done() override {}
+
+#ifdef POSTGRESPP_TRACING
+  bool traced() const override { return false; }
+#endif
+};
+
+/**
+ * Passes each result to the handler as it arrives and an empty result once
+ * done. The handler is called directly, on the executor of the connection.
+ */
+template <class ResultCallableT>
+class exec_all_operation : public pending_operation {
+public:
+  template <class HandlerT>
+  explicit exec_all_operation(HandlerT&& handler)
+    : handler_{std::forward<HandlerT>(handler)} {
+  }
+
+  void on_result(result&& res) override {
+    handler_(std::move(res));
+  }
+
+  void on_done() override {
+    handler_(result{nullptr});
+  }
+
+private:
+  ResultCallableT handler_;
+};
+
+/**
+ * Passes each chunk of rows to the chunk handler as it arrives and the final
+ * result to the handler once done. The final result has no rows unless the
+ * query failed. The chunk handler is called directly, on the executor of the
+ * connection, as no more rows are read until it returns.
+ */
+template <class ChunkCallableT, class ResultCallableT>
+class exec_stream_operation : public pending_operation {
+public:
+  template <class ChunkHandlerT, class HandlerT>
+  exec_stream_operation(ChunkHandlerT&& chunk_handler, HandlerT&& handler)
+    : chunk_handler_{std::forward<ChunkHandlerT>(chunk_handler)}
+    , handler_{std::forward<HandlerT>(handler)} {
+  }
+
+  void on_result(result&& res) override {
+    if (res.partial()) {
+      chunk_handler_(std::move(res));
+    } else {
+      res_ = std::move(res);
+    }
+  }
+
+  void on_done() override {
+    complete_handler(handler_, std::move(res_));
+  }
+
+private:
+  ChunkCallableT chunk_handler_;
+  ResultCallableT handler_;
+  result res_{nullptr};
+};
+
+/**
+ * Expects the single result of a COPY statement and passes it to the handler
+ * together with a value, e.g. a writer for the copy data.
+ */
+template <class ResultCallableT, class ValueT>
+class copy_operation : public pending_operation {
+public:
+  template <class HandlerT, class ValueArgT>
+  copy_operation(HandlerT&& handler, ValueArgT&& value)
+    : handler_{std::forward<HandlerT>(handler)}
+    , value_{std::forward<ValueArgT>(value)} {
+  }
+
+  void on_result(result&& res) override {
+    store_single_result(res_, std::move(res));
+  }
+
+  void on_error(result&& res) override {
+    res_ = std::move(res);
+  }
+
+  void on_done() override {
+    complete_handler(handler_, std::move(res_), std::move(value_));
+  }
+
+private:
+  ResultCallableT handler_;
+  ValueT value_;
+  result res_{nullptr};
+};
+
+/**
+ * Expects the result of preparing a statement followed by the results of
+ * executing it \p size times, and passes a \ref batch_result to the handler
+ * once done. After an error, the remaining executions are aborted by the
+ * server. If the whole batch is aborted by an earlier error in the pipeline,
+ * that is the error of the statement.
+ */
+template <class BatchCallableT>
+class batch_operation : public pending_operation {
+public:
+  template <class HandlerT>
+  batch_operation(HandlerT&& handler, std::size_t size)
+    : handler_{std::forward<HandlerT>(handler)}
+    , res_{size} {
+  }
+
+  void on_result(result&& res) override {
+    // Only the first error is kept, so a PIPELINE_ABORTED result is the error
+    // unless the batch failed itself, e.g. after a query before it failed.
+    if (!res.ok()) {
+      res_.set_error(query_ == 0 ? batch_result::npos : query_ - 1, std::move(res));
+    } else if (query_ > 0 && res.has_affected_rows()) {
+      res_.affected_rows_[query_ - 1] = res.affected_rows();
+    }
+  }
+
+  bool on_query_done() override {
+    return ++query_ <= res_.size();
+  }
+
+  void on_done() override {
+    complete_handler(handler_, std::move(res_));
+  }
+
+private:
+  BatchCallableT handler_;
+  batch_result res_;
+
+  /// The query whose results are being received, 0 is the prepare.
+  std::size_t query_ = 0;
+};
+
+/**
+ * Marks a pipeline synchronization point. It is completed by the
+ * PGRES_PIPELINE_SYNC result instead of an empty one.
+ */
+class pipeline_sync_operation : public pending_operation {
+public:
+  void on_result(result&&) override {}
+
+  void on_done() override {}
+
+#ifdef POSTGRESPP_TRACING
+  bool traced() const override { return false; }
+#endif
+};
+
+}
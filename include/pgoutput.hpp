@@ -0,0 +1,480 @@
+#pragma once
+
+#include "binary_copy.hpp"
+
+#include <libpq-fe.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include <variant>
+
+namespace postgrespp { namespace pgoutput {
+
+/// A position in the write-ahead log.
+using lsn_t = std::uint64_t;
+
+/// Microseconds since 2000-01-01 00:00:00 UTC, as the server sends times.
+using timestamp_t = std::int64_t;
+
+/**
+ * Reads the fields of a message in order. Throws std::length_error if the
+ * message ends too early.
+ */
+class message_reader {
+public:
+  message_reader(const char* data, std::size_t length)
+    : pos_{data}
+    , end_{data + length} {
+  }
+
+  template <class T>
+  T read() {
+    require(sizeof(T));
+
+    const auto value = binary_copy::load_big_endian<T>(pos_);
+    pos_ += sizeof(T);
+
+    return value;
+  }
+
+  char read_byte() {
+    require(1);
+
+    return *pos_++;
+  }
+
+  /// Reads a null-terminated string.
+  std::string_view read_string() {
+    const auto nul = static_cast<const char*>(std::memchr(pos_, '\0', end_ - pos_));
+
+    if (!nul)
+      throw std::length_error{"malformed pgoutput message"};
+
+    const std::string_view s{pos_, static_cast<std::size_t>(nul - pos_)};
+    pos_ = nul + 1;
+
+    return s;
+  }
+
+  std::string_view read_bytes(std::size_t n) {
+    require(n);
+
+    const std::string_view s{pos_, n};
+    pos_ += n;
+
+    return s;
+  }
+
+  const char* position() const { return pos_; }
+
+  std::size_t remaining() const { return static_cast<std::size_t>(end_ - pos_); }
+
+private:
+  void require(std::size_t n) const {
+    if (static_cast<std::size_t>(end_ - pos_) < n)
+      throw std::length_error{"malformed pgoutput message"};
+  }
+
+private:
+  const char* pos_;
+  const char* end_;
+};
+
+/// A column value of a \ref tuple_data.
+struct column_value {
+  enum class kind_t : char {
+    null = 'n',
+
+    /// An unchanged TOASTed value, which is not sent.
+    unchanged = 'u',
+
+    text = 't',
+    binary = 'b',
+  };
+
+  kind_t kind;
+
+  /// The value in text or binary format; empty unless kind is text or binary.
+  std::string_view data;
+};
+
+/**
+ * The column values of a row. It refers to the data of the message and is
+ * decoded as it is iterated.
+ */
+class tuple_data {
+public:
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = column_value;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const column_value*;
+    using reference = column_value;
+
+  public:
+    const_iterator(const char* pos, const char* end)
+      : pos_{pos}
+      , end_{end} {
+    }
+
+    column_value operator*() const {
+      message_reader r{pos_, static_cast<std::size_t>(end_ - pos_)};
+
+      return read_value(r);
+    }
+
+    const_iterator& operator++() {
+      message_reader r{pos_, static_cast<std::size_t>(end_ - pos_)};
+      read_value(r);
+      pos_ = r.position();
+
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      auto ret = *this;
+      ++*this;
+      return ret;
+    }
+
+    bool operator==(const const_iterator& rhs) const { return pos_ == rhs.pos_; }
+    bool operator!=(const const_iterator& rhs) const { return pos_ != rhs.pos_; }
+
+  private:
+    const char* pos_;
+    const char* end_;
+  };
+
+public:
+  tuple_data() = default;
+
+  /// Reads the TupleData at the position of \p r and skips it.
+  explicit tuple_data(message_reader& r) {
+    size_ = static_cast<std::size_t>(r.read<std::int16_t>());
+    begin_ = r.position();
+
+    for (std::size_t i = 0; i < size_; ++i)
+      read_value(r);
+
+    end_ = r.position();
+  }
+
+  std::size_t size() const { return size_; }
+
+  const_iterator begin() const { return {begin_, end_}; }
+  const_iterator end() const { return {end_, end_}; }
+
+private:
+  static column_value read_value(message_reader& r) {
+    const auto kind = static_cast<column_value::kind_t>(r.read_byte());
+
+    switch (kind) {
+      case column_value::kind_t::null:
+      case column_value::kind_t::unchanged:
+        return {kind, {}};
+      case column_value::kind_t::text:
+      case column_value::kind_t::binary: {
+        const auto length = r.read<std::int32_t>();
+
+        if (length < 0)
+          throw std::length_error{"malformed pgoutput message"};
+
+        return {kind, r.read_bytes(static_cast<std::size_t>(length))};
+      }
+    }
+
+    throw std::length_error{"malformed pgoutput message"};
+  }
+
+private:
+  const char* begin_ = nullptr;
+  const char* end_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+struct begin {
+  lsn_t final_lsn;
+  timestamp_t commit_time;
+  std::uint32_t xid;
+};
+
+struct commit {
+  std::uint8_t flags;
+  lsn_t commit_lsn;
+  lsn_t end_lsn;
+  timestamp_t commit_time;
+};
+
+struct origin {
+  lsn_t commit_lsn;
+  std::string_view name;
+};
+
+/// A column of a \ref relation.
+struct relation_column {
+  /// 1 if the column is part of the key.
+  std::uint8_t flags;
+  std::string_view name;
+  Oid type;
+  std::int32_t type_modifier;
+};
+
+/**
+ * Describes a table before the first change to it is sent. Its columns are
+ * decoded as they are iterated.
+ */
+struct relation {
+  class columns_t {
+  public:
+    class const_iterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = relation_column;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const relation_column*;
+      using reference = relation_column;
+
+    public:
+      const_iterator(const char* pos, const char* end)
+        : pos_{pos}
+        , end_{end} {
+      }
+
+      relation_column operator*() const {
+        message_reader r{pos_, static_cast<std::size_t>(end_ - pos_)};
+
+        return read_column(r);
+      }
+
+      const_iterator& operator++() {
+        message_reader r{pos_, static_cast<std::size_t>(end_ - pos_)};
+        read_column(r);
+        pos_ = r.position();
+
+        return *this;
+      }
+
+      const_iterator operator++(int) {
+        auto ret = *this;
+        ++*this;
+        return ret;
+      }
+
+      bool operator==(const const_iterator& rhs) const { return pos_ == rhs.pos_; }
+      bool operator!=(const const_iterator& rhs) const { return pos_ != rhs.pos_; }
+
+    private:
+      const char* pos_;
+      const char* end_;
+    };
+
+  public:
+    columns_t() = default;
+
+    /// Reads the columns at the position of \p r and skips them.
+    explicit columns_t(message_reader& r) {
+      size_ = static_cast<std::size_t>(r.read<std::int16_t>());
+      begin_ = r.position();
+
+      for (std::size_t i = 0; i < size_; ++i)
+        read_column(r);
+
+      end_ = r.position();
+    }
+
+    std::size_t size() const { return size_; }
+
+    const_iterator begin() const { return {begin_, end_}; }
+    const_iterator end() const { return {end_, end_}; }
+
+  private:
+    static relation_column read_column(message_reader& r) {
+      relation_column column;
+
+      column.flags = static_cast<std::uint8_t>(r.read_byte());
+      column.name = r.read_string();
+      column.type = static_cast<Oid>(r.read<std::uint32_t>());
+      column.type_modifier = r.read<std::int32_t>();
+
+      return column;
+    }
+
+  private:
+    const char* begin_ = nullptr;
+    const char* end_ = nullptr;
+    std::size_t size_ = 0;
+  };
+
+  Oid relation_id;
+  std::string_view nspname;
+  std::string_view relname;
+  char replica_identity;
+  columns_t columns;
+};
+
+struct type {
+  Oid type_id;
+  std::string_view nspname;
+  std::string_view name;
+};
+
+struct insert {
+  Oid relation_id;
+  tuple_data new_tuple;
+};
+
+struct update {
+  Oid relation_id;
+
+  /**
+   * 'K' if \ref old_tuple holds the key columns of the old row, 'O' if it
+   * holds the whole old row, or '\0' if it was not sent.
+   */
+  char old_kind;
+  tuple_data old_tuple;
+  tuple_data new_tuple;
+};
+
+/// A deleted row; named so as delete is a keyword.
+struct delete_ {
+  Oid relation_id;
+
+  /// 'K' if \ref old_tuple holds the key columns, 'O' if it holds the row.
+  char old_kind;
+  tuple_data old_tuple;
+};
+
+struct truncate {
+  /// 1 for CASCADE, 2 for RESTART IDENTITY.
+  std::uint8_t options;
+
+  std::size_t size() const { return size_; }
+
+  /// The ID of the \p i th truncated relation.
+  Oid relation_id(std::size_t i) const {
+    return static_cast<Oid>(binary_copy::load_big_endian<std::uint32_t>(ids_ + i * sizeof(std::uint32_t)));
+  }
+
+  const char* ids_;
+  std::size_t size_;
+};
+
+/// A message of a type that is not decoded, e.g. a logical decoding message.
+struct unknown {
+  char type;
+  std::string_view data;
+};
+
+using message = std::variant<begin, commit, origin, relation, type,
+      insert, update, delete_, truncate, unknown>;
+
+/**
+ * Decodes a message of protocol version 1 of the pgoutput plugin. The
+ * message refers to \p data and must not outlive it.
+ * Throws std::length_error if the message is malformed.
+ */
+inline message parse(const char* data, std::size_t length) {
+  message_reader r{data, length};
+
+  const auto type = r.read_byte();
+
+  switch (type) {
+    case 'B': {
+      begin m;
+      m.final_lsn = r.read<std::uint64_t>();
+      m.commit_time = r.read<std::int64_t>();
+      m.xid = r.read<std::uint32_t>();
+      return m;
+    }
+    case 'C': {
+      commit m;
+      m.flags = static_cast<std::uint8_t>(r.read_byte());
+      m.commit_lsn = r.read<std::uint64_t>();
+      m.end_lsn = r.read<std::uint64_t>();
+      m.commit_time = r.read<std::int64_t>();
+      return m;
+    }
+    case 'O': {
+      origin m;
+      m.commit_lsn = r.read<std::uint64_t>();
+      m.name = r.read_string();
+      return m;
+    }
+    case 'R': {
+      relation m;
+      m.relation_id = static_cast<Oid>(r.read<std::uint32_t>());
+      m.nspname = r.read_string();
+      m.relname = r.read_string();
+      m.replica_identity = r.read_byte();
+      m.columns = relation::columns_t{r};
+      return m;
+    }
+    case 'Y': {
+      pgoutput::type m;
+      m.type_id = static_cast<Oid>(r.read<std::uint32_t>());
+      m.nspname = r.read_string();
+      m.name = r.read_string();
+      return m;
+    }
+    case 'I': {
+      insert m;
+      m.relation_id = static_cast<Oid>(r.read<std::uint32_t>());
+
+      if (r.read_byte() != 'N')
+        throw std::length_error{"malformed pgoutput message"};
+
+      m.new_tuple = tuple_data{r};
+      return m;
+    }
+    case 'U': {
+      update m;
+      m.relation_id = static_cast<Oid>(r.read<std::uint32_t>());
+      m.old_kind = '\0';
+
+      auto kind = r.read_byte();
+
+      if (kind == 'K' || kind == 'O') {
+        m.old_kind = kind;
+        m.old_tuple = tuple_data{r};
+        kind = r.read_byte();
+      }
+
+      if (kind != 'N')
+        throw std::length_error{"malformed pgoutput message"};
+
+      m.new_tuple = tuple_data{r};
+      return m;
+    }
+    case 'D': {
+      delete_ m;
+      m.relation_id = static_cast<Oid>(r.read<std::uint32_t>());
+      m.old_kind = r.read_byte();
+
+      if (m.old_kind != 'K' && m.old_kind != 'O')
+        throw std::length_error{"malformed pgoutput message"};
+
+      m.old_tuple = tuple_data{r};
+      return m;
+    }
+    case 'T': {
+      truncate m;
+      const auto size = r.read<std::int32_t>();
+
+      if (size < 0)
+        throw std::length_error{"malformed pgoutput message"};
+
+      m.size_ = static_cast<std::size_t>(size);
+      m.options = static_cast<std::uint8_t>(r.read_byte());
+      m.ids_ = r.read_bytes(m.size_ * sizeof(std::uint32_t)).data();
+      return m;
+    }
+    default:
+      return unknown{type, std::string_view{r.position(), r.remaining()}};
+  }
+}
+
+}}
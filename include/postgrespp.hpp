@@ -1,6 +1,23 @@
 #pragma once
 
+#include "async_connect.hpp"
 #include "async_exec.hpp"
 #include "async_exec_prepared.hpp"
+#include "batch_result.hpp"
+#include "cluster_client.hpp"
 #include "connection.hpp"
+#include "connection_pool.hpp"
+#include "copy_in_writer.hpp"
+#include "copy_out_reader.hpp"
+#include "io_context_pool.hpp"
+#include "latency_histogram.hpp"
+#include "notification.hpp"
+#include "pgoutput.hpp"
+#include "replication_stream.hpp"
+#include "retry_transaction.hpp"
+#include "static_query.hpp"
+#include "tracing.hpp"
+#include "transaction_mode.hpp"
+#include "with_error_code.hpp"
+#include "with_timeout.hpp"
 #include "work.hpp"
@@ -6,4 +6,25 @@ namespace postgrespp {
 
 using query = std::string;
 
+/**
+ * Refers to a NUL-terminated query without owning it, so that passing a
+ * string literal does not allocate a std::string. The query is only read
+ * while it is being sent.
+ */
+class query_view {
+public:
+  query_view(const char* query) noexcept
+    : query_{query} {
+  }
+
+  query_view(const std::string& query) noexcept
+    : query_{query.c_str()} {
+  }
+
+  const char* c_str() const noexcept { return query_; }
+
+private:
+  const char* query_;
+};
+
 }
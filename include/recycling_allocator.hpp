@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <new>
+
+namespace postgrespp {
+
+/**
+ * Keeps the memory of a few freed operations for reuse, so that a
+ * connection running one query after another does not allocate for them.
+ * Like the per-thread cache of asio, but with more than one block so that
+ * operations in a pipeline are covered too. It is not thread safe and must
+ * only be used from the connection's executor.
+ */
+class operation_recycler {
+public:
+  static constexpr std::size_t cache_size = 16;
+
+public:
+  operation_recycler() = default;
+
+  operation_recycler(const operation_recycler&) = delete;
+  operation_recycler& operator=(const operation_recycler&) = delete;
+
+  ~operation_recycler() {
+    for (auto& b : blocks_)
+      ::operator delete(b.pointer);
+  }
+
+  void* allocate(std::size_t size) {
+    for (auto& b : blocks_) {
+      if (b.pointer && b.size >= size) {
+        const auto pointer = b.pointer;
+        b = {};
+        return pointer;
+      }
+    }
+
+    return ::operator new(size);
+  }
+
+  void deallocate(void* pointer, std::size_t size) {
+    for (auto& b : blocks_) {
+      if (!b.pointer) {
+        b = {pointer, size};
+        return;
+      }
+    }
+
+    ::operator delete(pointer);
+  }
+
+private:
+  struct block {
+    void* pointer = nullptr;
+    std::size_t size = 0;
+  };
+
+  std::array<block, cache_size> blocks_{};
+};
+
+/// Allocates from an \ref operation_recycler.
+template <class T>
+class recycling_allocator {
+  template <class>
+  friend class recycling_allocator;
+public:
+  using value_type = T;
+
+public:
+  explicit recycling_allocator(operation_recycler& recycler) noexcept
+    : recycler_{&recycler} {
+  }
+
+  template <class U>
+  recycling_allocator(const recycling_allocator<U>& other) noexcept
+    : recycler_{other.recycler_} {
+  }
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(recycler_->allocate(sizeof(T) * n));
+  }
+
+  void deallocate(T* p, std::size_t n) {
+    recycler_->deallocate(p, sizeof(T) * n);
+  }
+
+  template <class U>
+  bool operator==(const recycling_allocator<U>& rhs) const noexcept {
+    return recycler_ == rhs.recycler_;
+  }
+
+  template <class U>
+  bool operator!=(const recycling_allocator<U>& rhs) const noexcept {
+    return recycler_ != rhs.recycler_;
+  }
+
+private:
+  operation_recycler* recycler_;
+};
+
+}
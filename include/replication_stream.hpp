@@ -0,0 +1,396 @@
+#pragma once
+
+#include "basic_connection.hpp"
+#include "pgoutput.hpp"
+#include "socket_operations.hpp"
+
+#include <libpq-fe.h>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/endian/conversion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace postgrespp {
+
+/// Waits for the end of a \ref basic_replication_stream.
+class replication_waiter {
+public:
+  using ptr = std::unique_ptr<replication_waiter>;
+
+public:
+  virtual ~replication_waiter() = default;
+
+  virtual void complete(result&& res) = 0;
+};
+
+template <class HandlerT>
+class replication_waiter_impl : public replication_waiter {
+public:
+  explicit replication_waiter_impl(HandlerT&& handler)
+    : handler_{std::move(handler)} {
+  }
+
+  void complete(result&& res) override {
+    complete_handler(handler_, std::move(res));
+  }
+
+private:
+  HandlerT handler_;
+};
+
+/// Formats \p lsn the way the server does, e.g. "16/B374D848".
+inline std::string format_lsn(pgoutput::lsn_t lsn) {
+  char buf[20];
+  std::snprintf(buf, sizeof(buf), "%X/%X",
+      static_cast<unsigned>(lsn >> 32), static_cast<unsigned>(lsn));
+
+  return buf;
+}
+
+/**
+ * Consumes the changes of a logical replication slot that uses the pgoutput
+ * plugin. The connection must have been opened with replication=database in
+ * its connection string and cannot be used for anything else while the
+ * stream runs.
+ *
+ * Changes arrive as XLogData messages in COPY BOTH mode and are read with
+ * PQgetCopyData one at a time, then decoded in place; see \ref pgoutput.
+ * Standby status updates reporting the received and acknowledged positions
+ * are sent on a timer and whenever the server asks for one.
+ *
+ * The stream must not be moved or destroyed before its handler is called.
+ */
+template <class ConnectionT>
+class basic_replication_stream
+  : public socket_operations<basic_replication_stream<ConnectionT>> {
+  friend class socket_operations<basic_replication_stream<ConnectionT>>;
+public:
+  using connection_t = ConnectionT;
+  using lsn_t = pgoutput::lsn_t;
+  using message_handler_t = std::function<void(lsn_t, const pgoutput::message&)>;
+
+private:
+  using result_t = typename socket_operations<basic_replication_stream>::result_t;
+  using clock_t = std::chrono::steady_clock;
+
+  struct copy_data_deleter {
+    void operator()(char* data) const { PQfreemem(data); }
+  };
+
+  /// Microseconds between the Unix epoch and 2000-01-01.
+  static constexpr std::int64_t postgres_epoch = 946684800000000;
+
+public:
+  /**
+   * \p status_interval how often a standby status update is sent. It must be
+   * shorter than wal_sender_timeout on the server.
+   */
+  explicit basic_replication_stream(connection_t& c,
+      clock_t::duration status_interval = std::chrono::seconds{10})
+    : c_{c}
+    , timer_{c.get_executor()}
+    , status_interval_{status_interval} {
+  }
+
+  basic_replication_stream(const basic_replication_stream&) = delete;
+  basic_replication_stream& operator=(const basic_replication_stream&) = delete;
+
+  /**
+   * Starts streaming from logical replication slot \p slot.
+   * \p start_lsn the position to start from; the server starts from the
+   * confirmed position of the slot if it is further.
+   * \p publications a comma separated list of publication names.
+   * \p message_handler will be called with the WAL position and the decoded
+   * message for each change. The message refers to data that is freed once
+   * it returns. No more data is read until it returns.
+   * \p handler will be called with the result of START_REPLICATION when the
+   * stream ends, either because of an error or after \ref stop(). If a
+   * message cannot be decoded or \p message_handler throws, the stream is
+   * stopped and the handler is called with \ref error::unexpected_result.
+   *
+   * This function must not be called again before the handler is called.
+   */
+  template <class CompletionTokenT>
+  auto async_start(const std::string& slot, lsn_t start_lsn, const std::string& publications,
+      message_handler_t message_handler, CompletionTokenT&& handler) {
+    if (waiter_)
+      throw std::logic_error{"replication stream is already running"};
+
+    auto& c = connection();
+
+    const std::string query = "START_REPLICATION SLOT " + c.escape_identifier(slot) +
+      " LOGICAL " + format_lsn(start_lsn) +
+      " (proto_version '1', publication_names " + c.escape_literal(publications) + ")";
+
+    // A walsender only accepts the simple query protocol.
+    if (PQsendQuery(c.underlying_handle(), query.c_str()) != 1)
+      throw std::runtime_error{"could not send query: " + std::string{c.last_error_message()}};
+
+    message_handler_ = std::move(message_handler);
+    received_lsn_ = start_lsn;
+    flushed_lsn_ = std::max(flushed_lsn_, start_lsn);
+
+    auto initiation = [this](auto&& handler) {
+      using handler_t = std::decay_t<decltype(handler)>;
+
+      waiter_ = std::make_unique<replication_waiter_impl<handler_t>>(std::move(handler));
+
+      this->handle_exec([this](result_t res) { on_start(std::move(res)); });
+    };
+
+    return boost::asio::async_initiate<
+      CompletionTokenT, void(result_t)>(
+          initiation, handler);
+  }
+
+  /**
+   * Reports that all changes up to \p lsn have been processed, so the server
+   * no longer needs to keep the WAL before it. Sent with the next status
+   * update.
+   */
+  void acknowledge(lsn_t lsn) { flushed_lsn_ = std::max(flushed_lsn_, lsn); }
+
+  /**
+   * Sends a last status update and ends the stream. The handler is called
+   * once the server has ended it too.
+   */
+  void stop() {
+    if (!streaming_)
+      return;
+
+    streaming_ = false;
+    timer_.cancel();
+
+    const auto conn = connection().underlying_handle();
+
+    send_status(false);
+
+    if (PQputCopyEnd(conn, nullptr) == -1)
+      fail();
+    else
+      flush();
+  }
+
+  /// The position of the last change received.
+  lsn_t received_lsn() const { return received_lsn_; }
+
+  /// The position last passed to \ref acknowledge().
+  lsn_t flushed_lsn() const { return flushed_lsn_; }
+
+protected:
+  connection_t& connection() { return c_.get(); }
+
+private:
+  void on_start(result_t&& res) {
+    if (res.status() != result_t::status_t::COPY_BOTH) {
+      complete(std::move(res));
+    } else {
+      streaming_ = true;
+      schedule_status();
+      read();
+    }
+  }
+
+  void read() {
+    const auto conn = connection().underlying_handle();
+
+    for (;;) {
+      char* buf = nullptr;
+      const auto length = PQgetCopyData(conn, &buf, 1);
+
+      if (length > 0) {
+        const std::unique_ptr<char, copy_data_deleter> data{buf};
+
+        // The rest of the data is skipped once a message could not be handled.
+        if (!error_.done())
+          continue;
+
+        try {
+          on_copy_data(data.get(), static_cast<std::size_t>(length));
+        } catch (const std::exception&) {
+          stop_with_error();
+
+          // Already completed if the copy could not be ended.
+          if (!waiter_)
+            return;
+        }
+      } else if (length == 0) {
+        wait_read_ready();
+        return;
+      } else if (length == -1) {
+        // The server ended the copy, the result of START_REPLICATION follows.
+        streaming_ = false;
+        timer_.cancel();
+        this->handle_exec([this](result_t res) { complete(std::move(res)); });
+        return;
+      } else {
+        fail();
+        return;
+      }
+    }
+  }
+
+  void on_copy_data(const char* data, std::size_t length) {
+    pgoutput::message_reader r{data, length};
+
+    switch (r.read_byte()) {
+      case 'w': {
+        const auto wal_start = r.read<std::uint64_t>();
+        r.read<std::uint64_t>(); // The end of the WAL on the server.
+        r.read<std::int64_t>(); // The time the message was sent.
+
+        received_lsn_ = std::max(received_lsn_, wal_start);
+
+        const auto payload = r.read_bytes(r.remaining());
+        message_handler_(wal_start, pgoutput::parse(payload.data(), payload.size()));
+        break;
+      }
+      case 'k': {
+        r.read<std::uint64_t>();
+        r.read<std::int64_t>();
+
+        if (r.read_byte() != 0 && streaming_)
+          send_status(true);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  void wait_read_ready() {
+    auto& socket = connection().socket();
+
+    socket.async_wait(std::decay_t<decltype(socket)>::wait_read,
+        [this](const auto& ec) {
+          if (!waiter_)
+            return;
+
+          if (ec || PQconsumeInput(connection().underlying_handle()) != 1) {
+            fail();
+          } else {
+            read();
+          }
+        });
+  }
+
+  void schedule_status() {
+    timer_.expires_after(status_interval_);
+    timer_.async_wait([this](const auto& ec) {
+          if (ec || !streaming_)
+            return;
+
+          send_status(true);
+          schedule_status();
+        });
+  }
+
+  /**
+   * Queues a standby status update; a full send buffer leaves it to the next
+   * one.
+   */
+  void send_status(bool do_flush) {
+    const auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() - postgres_epoch;
+
+    char buf[1 + 4 * sizeof(std::int64_t) + 1];
+    char* pos = buf;
+
+    *pos++ = 'r';
+    pos = store(pos, received_lsn_);
+    pos = store(pos, flushed_lsn_);
+    pos = store(pos, flushed_lsn_);
+    pos = store(pos, static_cast<std::uint64_t>(now));
+    *pos++ = 0;
+
+    if (PQputCopyData(connection().underlying_handle(), buf, sizeof(buf)) == -1)
+      fail();
+    else if (do_flush)
+      flush();
+  }
+
+  void flush() {
+    if (flushing_)
+      return;
+
+    const auto res = PQflush(connection().underlying_handle());
+
+    if (res == 1) {
+      auto& socket = connection().socket();
+
+      flushing_ = true;
+      socket.async_wait(std::decay_t<decltype(socket)>::wait_write,
+          [this](const auto& ec) {
+            flushing_ = false;
+
+            if (ec)
+              fail();
+            else
+              flush();
+          });
+    } else if (res == -1) {
+      fail();
+    }
+  }
+
+  static char* store(char* pos, std::uint64_t value) {
+    const auto big = boost::endian::native_to_big(value);
+    std::memcpy(pos, &big, sizeof(big));
+
+    return pos + sizeof(big);
+  }
+
+  /**
+   * Stops the stream after a message could not be handled. The handler gets
+   * the error once the server has ended the stream.
+   */
+  void stop_with_error() {
+    error_ = result_t::make_error(error::unexpected_result);
+    stop();
+  }
+
+  void fail() {
+    complete(result_t{PQmakeEmptyPGresult(connection().underlying_handle(), PGRES_FATAL_ERROR)});
+  }
+
+  void complete(result_t&& res) {
+    if (!waiter_)
+      return;
+
+    streaming_ = false;
+    timer_.cancel();
+
+    const auto waiter = std::move(waiter_);
+    waiter->complete(error_.done() ? std::move(res) : std::move(error_));
+  }
+
+private:
+  std::reference_wrapper<connection_t> c_;
+  boost::asio::steady_timer timer_;
+  clock_t::duration status_interval_;
+  message_handler_t message_handler_;
+  replication_waiter::ptr waiter_;
+
+  /// See \ref stop_with_error().
+  result_t error_{nullptr};
+  lsn_t received_lsn_ = 0;
+  lsn_t flushed_lsn_ = 0;
+  bool streaming_ = false;
+  bool flushing_ = false;
+};
+
+using replication_stream = basic_replication_stream<basic_connection>;
+
+}
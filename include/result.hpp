@@ -1,13 +1,19 @@
 #pragma once
 
+#include "error.hpp"
 #include "result_iterator.hpp"
 #include "row.hpp"
+#include "sqlstate.hpp"
 
 #include <libpq-fe.h>
 
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 namespace postgrespp {
 
@@ -22,8 +28,17 @@ public:
     EMPTY_QUERY = PGRES_EMPTY_QUERY,
     COMMAND_OK = PGRES_COMMAND_OK,
     TUPLES_OK = PGRES_TUPLES_OK,
+    COPY_OUT = PGRES_COPY_OUT,
+    COPY_IN = PGRES_COPY_IN,
     BAD_RESPONSE = PGRES_BAD_RESPONSE,
     FATAL_ERROR = PGRES_FATAL_ERROR,
+    COPY_BOTH = PGRES_COPY_BOTH,
+    SINGLE_TUPLE = PGRES_SINGLE_TUPLE,
+#ifdef LIBPQ_HAS_CHUNK_MODE
+    TUPLES_CHUNK = PGRES_TUPLES_CHUNK,
+#endif
+    PIPELINE_SYNC = PGRES_PIPELINE_SYNC,
+    PIPELINE_ABORTED = PGRES_PIPELINE_ABORTED,
   };
 
 public:
@@ -34,7 +49,8 @@ public:
   result(const result& other) = delete;
 
   result(result&& other) noexcept
-    : res_{other.res_} {
+    : res_{other.res_}
+    , error_{other.error_} {
     other.res_ = nullptr;
   }
 
@@ -43,6 +59,7 @@ public:
   result& operator=(result&& other) noexcept {
     using std::swap;
     swap(res_, other.res_);
+    swap(error_, other.error_);
 
     return *this;
   }
@@ -53,6 +70,17 @@ public:
     }
   }
 
+  /**
+   * A failed result that has not been received from the server, e.g. for a
+   * query that timed out. Its \ref error_code() is \p ec.
+   */
+  static result make_error(const boost::system::error_code& ec) {
+    result res{PQmakeEmptyPGresult(nullptr, PGRES_FATAL_ERROR)};
+    res.error_ = ec;
+
+    return res;
+  }
+
   /**
    * If true, indicates that we are done and this result is empty. An empty
    * result is typically used to mark the end of a series of result objects
@@ -63,7 +91,25 @@ public:
    */
   bool done() const { return res_ == nullptr; }
 
-  bool ok() const { return status() == status_t::TUPLES_OK || status() == status_t::COMMAND_OK; }
+  bool ok() const {
+    return status() == status_t::TUPLES_OK || status() == status_t::COMMAND_OK || partial() || copying();
+  }
+
+  /// If true, the connection has switched to COPY mode.
+  bool copying() const {
+    return status() == status_t::COPY_OUT || status() == status_t::COPY_IN || status() == status_t::COPY_BOTH;
+  }
+
+  /**
+   * If true, this result holds a chunk of the rows of a query that streams
+   * its rows (see \ref basic_transaction::async_exec_stream).
+   */
+  bool partial() const {
+#ifdef LIBPQ_HAS_CHUNK_MODE
+    if (status() == status_t::TUPLES_CHUNK) return true;
+#endif
+    return status() == status_t::SINGLE_TUPLE;
+  }
 
   status_t status() const { return static_cast<status_t>(PQresultStatus(res_)); }
 
@@ -90,6 +136,61 @@ public:
 
   size_type size() const { return PQntuples(res_); }
 
+  /**
+   * Decodes all rows into \p T, a std::tuple or an aggregate of the column
+   * types in order. The columns are validated once, see \ref decoding_plan.
+   */
+  template <class T>
+  std::vector<T> as() const {
+    const decoding_plan<T> plan{res_};
+
+    std::vector<T> rows;
+    rows.reserve(size());
+
+    for (size_type i = 0; i < size(); ++i)
+      rows.push_back(plan.decode(i));
+
+    return rows;
+  }
+
+  /**
+   * Decodes column \p col into a contiguous vector, or a std::vector<bool>
+   * filled from a temporary array for bool. NULL fields are decoded as T{}
+   * and their bits in \p nulls are set, if given; otherwise a NULL field
+   * throws.
+   */
+  template <class T>
+  std::vector<T> column(size_type col, std::vector<bool>* nulls = nullptr) const {
+    if constexpr (std::is_same_v<T, bool>) {
+      // std::vector<bool> has no contiguous storage to decode into.
+      const std::unique_ptr<bool[]> decoded{new bool[size()]};
+
+      column(col, decoded.get(), nulls);
+
+      return std::vector<bool>(decoded.get(), decoded.get() + size());
+    } else {
+      std::vector<T> values(size());
+
+      column(col, values.data(), nulls);
+
+      return values;
+    }
+  }
+
+  /**
+   * Decodes column \p col into \p out, which must have room for \ref size()
+   * values. See \ref column(size_type, std::vector<bool>*).
+   */
+  template <class T>
+  void column(size_type col, T* out, std::vector<bool>* nulls = nullptr) const {
+    if (col >= static_cast<size_type>(PQnfields(res_))) throw std::out_of_range{"column >= number of columns"};
+
+    column_decoder<T>::decode_column(res_, static_cast<int>(col), out, nulls);
+  }
+
+  /// True if \ref affected_rows() is available for the command of this result.
+  bool has_affected_rows() const { return *PQcmdTuples(res_) != '\0'; }
+
   size_type affected_rows() const {
     const auto s = PQcmdTuples(res_);
 
@@ -101,8 +202,41 @@ public:
 
   const char* error_message() const { return PQresultErrorMessage(res_); }
 
+  /// The SQLSTATE of the error, or nullptr if there is none.
+  const char* sqlstate() const { return PQresultErrorField(res_, PG_DIAG_SQLSTATE); }
+
+  /**
+   * Success unless the query failed. Then it is the \ref sqlstate() of the
+   * error in the category of \ref sqlstate::get_category(), or
+   * \ref error::connection_broken if there is none, or
+   * \ref error::pipeline_aborted, or \ref error::unexpected_result for a
+   * BAD_RESPONSE result without a SQLSTATE. See also \ref make_error().
+   */
+  boost::system::error_code error_code() const {
+    if (error_)
+      return error_;
+
+    if (ok() || status() == status_t::EMPTY_QUERY)
+      return {};
+
+    if (status() == status_t::PIPELINE_ABORTED)
+      return error::pipeline_aborted;
+
+    const auto code = sqlstate();
+
+    if (!code) {
+      return status() == status_t::BAD_RESPONSE ?
+        error::unexpected_result : error::connection_broken;
+    }
+
+    return sqlstate::make_error_code(code);
+  }
+
 private:
   PGresult* res_;
+
+  /// See \ref make_error().
+  boost::system::error_code error_;
 };
 
 }
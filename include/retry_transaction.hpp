@@ -0,0 +1,203 @@
+#pragma once
+
+#include "basic_connection.hpp"
+#include "connection_pool.hpp"
+#include "sqlstate.hpp"
+
+#include <boost/system/error_code.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+#ifdef BOOST_ASIO_HAS_CO_AWAIT
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include <boost/system/system_error.hpp>
+#endif
+
+namespace postgrespp {
+
+/**
+ * Counts what \ref async_retry_transaction() did. It may be shared by many
+ * transactions and read from any thread.
+ */
+struct retry_counters {
+  /// Transactions run, each counted once however often it is retried.
+  std::atomic<std::uint64_t> transactions{0};
+
+  /// Attempts that were run again.
+  std::atomic<std::uint64_t> retries{0};
+
+  /// Attempts that failed with \ref sqlstate::serialization_failure.
+  std::atomic<std::uint64_t> serialization_failures{0};
+
+  /// Attempts that failed with \ref sqlstate::deadlock_detected.
+  std::atomic<std::uint64_t> deadlocks{0};
+
+  /// Transactions given up after \ref retry_policy::max_attempts.
+  std::atomic<std::uint64_t> exhausted{0};
+};
+
+/// How \ref async_retry_transaction() retries a transaction.
+struct retry_policy {
+  /// Maximum number of times the transaction is run, including the first.
+  std::size_t max_attempts = 5;
+
+  /// Upper bound of the delay before the first retry.
+  std::chrono::milliseconds initial_backoff{5};
+
+  /// Upper bound of the delay before any retry.
+  std::chrono::milliseconds max_backoff{1000};
+
+  /// Counts the attempts if set. It must outlive the transactions.
+  retry_counters* counters = nullptr;
+
+  /**
+   * The delay before retry \p retry, starting at 1. It is drawn uniformly
+   * from zero up to \ref initial_backoff doubled for each retry before, but
+   * at most \ref max_backoff, so that transactions that failed together do
+   * not collide again.
+   */
+  std::chrono::nanoseconds backoff(std::size_t retry) const;
+};
+
+/// Whether a transaction that failed with \p ec may succeed if run again.
+inline bool is_retryable(const boost::system::error_code& ec) {
+  return ec == sqlstate::serialization_failure || ec == sqlstate::deadlock_detected;
+}
+
+#ifdef BOOST_ASIO_HAS_CO_AWAIT
+
+namespace detail {
+
+template <class RWT, class IsolationT, class BodyT>
+boost::asio::awaitable<boost::system::error_code> run_transaction_once(basic_connection& c, BodyT& body) {
+  using boost::asio::use_awaitable;
+
+  auto txn = co_await c.async_transaction<RWT, IsolationT>(use_awaitable);
+
+  boost::system::error_code ec;
+
+  try {
+    ec = co_await body(txn);
+  } catch (const boost::system::system_error& e) {
+    // Any other exception rolls back as the transaction is destructed.
+    if (!is_retryable(e.code()))
+      throw;
+
+    ec = e.code();
+  }
+
+  if (ec) {
+    co_await txn.rollback(use_awaitable);
+    co_return ec;
+  }
+
+  const auto res = co_await txn.commit(use_awaitable);
+
+  co_return res.error_code();
+}
+
+template <class RWT, class IsolationT, class BodyT>
+boost::asio::awaitable<boost::system::error_code> retry_transaction(basic_connection& c,
+    BodyT body, retry_policy policy) {
+  const auto counters = policy.counters;
+
+  if (counters)
+    counters->transactions.fetch_add(1, std::memory_order_relaxed);
+
+  for (std::size_t attempt = 1;; ++attempt) {
+    const auto ec = co_await run_transaction_once<RWT, IsolationT>(c, body);
+
+    if (!is_retryable(ec))
+      co_return ec;
+
+    if (counters) {
+      auto& failures = ec == sqlstate::deadlock_detected ?
+        counters->deadlocks : counters->serialization_failures;
+      failures.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (attempt >= policy.max_attempts) {
+      if (counters)
+        counters->exhausted.fetch_add(1, std::memory_order_relaxed);
+
+      co_return ec;
+    }
+
+    if (counters)
+      counters->retries.fetch_add(1, std::memory_order_relaxed);
+
+    boost::asio::steady_timer timer{c.get_executor(), policy.backoff(attempt)};
+    co_await timer.async_wait(boost::asio::use_awaitable);
+  }
+}
+
+template <class RWT, class IsolationT, class BodyT>
+boost::asio::awaitable<boost::system::error_code> retry_transaction(connection_pool& pool,
+    BodyT body, retry_policy policy) {
+  boost::system::error_code ec;
+
+  auto c = co_await pool.async_acquire(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+  if (ec)
+    co_return ec;
+
+  co_return co_await retry_transaction<RWT, IsolationT>(*c, std::move(body), policy);
+}
+
+}
+
+/**
+ * Runs a transaction of \p RWT and \p IsolationT on \p c, see
+ * \ref basic_connection::async_transaction(), and runs it again while it
+ * fails with \ref sqlstate::serialization_failure or
+ * \ref sqlstate::deadlock_detected, as \p policy allows.
+ *
+ * \p body is called with the transaction for each attempt and returns a
+ * boost::asio::awaitable<boost::system::error_code>: success to commit,
+ * an error to roll back. Throwing a boost::system::system_error with one
+ * of the errors above retries as well; other exceptions end the transaction
+ * and are passed on. Failing to commit is retried the same way.
+ *
+ * \p handler is called with a std::exception_ptr and the error code of the
+ * last attempt, like for boost::asio::co_spawn().
+ *
+ * \code
+ * async_retry_transaction<read_write, serializable>(c,
+ *     [](auto& txn) -> awaitable<boost::system::error_code> {
+ *       const auto res = co_await txn.async_exec("UPDATE ...", use_awaitable);
+ *       co_return res.error_code();
+ *     }, retry_policy{}, use_awaitable);
+ * \endcode
+ */
+template <class RWT = void, class IsolationT = void, class BodyT, class CompletionTokenT>
+auto async_retry_transaction(basic_connection& c, BodyT body, retry_policy policy,
+    CompletionTokenT&& handler) {
+  return boost::asio::co_spawn(c.get_executor(),
+      detail::retry_transaction<RWT, IsolationT>(c, std::move(body), policy),
+      std::forward<CompletionTokenT>(handler));
+}
+
+/**
+ * Same as above with a connection acquired from \p pool for all attempts.
+ * Failing to acquire one is passed to the handler.
+ */
+template <class RWT = void, class IsolationT = void, class BodyT, class CompletionTokenT>
+auto async_retry_transaction(connection_pool& pool, BodyT body, retry_policy policy,
+    CompletionTokenT&& handler) {
+  return boost::asio::co_spawn(pool.get_executor(),
+      detail::retry_transaction<RWT, IsolationT>(pool, std::move(body), policy),
+      std::forward<CompletionTokenT>(handler));
+}
+
+#endif
+
+}
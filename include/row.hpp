@@ -1,5 +1,6 @@
 #pragma once
 
+#include "decoding_plan.hpp"
 #include "field.hpp"
 
 #include <libpq-fe.h>
@@ -30,6 +31,16 @@ public:
     return {res_, row_, n};
   }
 
+  /**
+   * Decodes the row into \p T, a std::tuple or an aggregate of the column
+   * types in order. The columns are validated on every call, use
+   * \ref result::as() or \ref decoding_plan to decode many rows.
+   */
+  template <class T>
+  T as() const {
+    return decoding_plan<T>{res_}.decode(row_);
+  }
+
 private:
   const PGresult* const res_;
   const size_type row_;
@@ -1,26 +1,40 @@
 #pragma once
 
+#include "batch_result.hpp"
+#include "field_type.hpp"
+#include "pending_operation.hpp"
+#include "query.hpp"
 #include "result.hpp"
+#include "static_query.hpp"
+#include "type_encoder.hpp"
+#include "type_oid.hpp"
+#include "utility.hpp"
 
 #include <boost/asio/async_result.hpp>
-#include <boost/asio/buffer.hpp>
-#include <boost/asio/error.hpp>
 
 #include <libpq-fe.h>
+
+#include <cstring>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace postgrespp {
 
 class result;
 
+template <class ConnectionT, class RowCallableT, class ResultCallableT>
+class basic_copy_out_reader;
+
 template <class DerivedT>
 class socket_operations {
 public:
   using result_t = result;
 
-private:
-  using error_code_t = boost::system::error_code;
-
 protected:
   using derived_t = DerivedT;
 
@@ -35,21 +49,350 @@ protected:
 
   ~socket_operations() = default;
 
+  /**
+   * Sends \p query with \p params bound to $1, $2, ... and queues \p handler
+   * to be called with its result. Uses the statement cache of the connection
+   * if it is enabled.
+   */
+  template <class ResultCallableT, class... Params>
+  auto send_query(query_view query, ResultCallableT&& handler,
+      Params&&... params) {
+    return send_query(query, param_types{}, std::forward<ResultCallableT>(handler),
+        std::forward<Params>(params)...);
+  }
+
+  /// Same as above with the parameter types of \p query sent along.
+  template <class... Ts, class ResultCallableT, class... Params>
+  auto send_query(const static_query<Ts...>& query, ResultCallableT&& handler,
+      Params&&... params) {
+    static_assert(static_query<Ts...>::template accepts<Params...>(),
+        "parameters do not match the types of the query");
+
+    return send_query(query.c_str(), query.types(), std::forward<ResultCallableT>(handler),
+        std::forward<Params>(params)...);
+  }
+
+  /**
+   * Sends \p query, declaring the types of its parameters as \p types, and
+   * queues \p handler to be called with its result.
+   */
+  template <class ResultCallableT, class... Params>
+  auto send_query(query_view query, param_types types, ResultCallableT&& handler,
+      Params&&... params) {
+    auto& c = derived().connection();
+
+    if (c.statements().capacity() > 0) {
+      if (const auto name = c.statements().find(query.c_str(), types)) {
+        send_query_prepared_params(*name, std::forward<Params>(params)...);
+        c.trace_send(query.c_str());
+
+        return handle_exec(std::forward<ResultCallableT>(handler));
+      } else if (c.pipeline_mode() || !c.busy()) {
+        return send_query_preparing(query, types, std::forward<ResultCallableT>(handler),
+            std::forward<Params>(params)...);
+      }
+    }
+
+    send_query_params(query, types, std::forward<Params>(params)...);
+
+    return handle_exec(std::forward<ResultCallableT>(handler));
+  }
+
+  /**
+   * Adds \p query to the statement cache of the connection, then sends the
+   * statement and executes it in one round trip. Outside of pipeline mode,
+   * that is done in a transient pipeline.
+   */
+  template <class ResultCallableT, class... Params>
+  auto send_query_preparing(query_view query, param_types types, ResultCallableT&& handler,
+      Params&&... params) {
+    auto& c = derived().connection();
+    const auto transient_pipeline = !c.pipeline_mode();
+
+    if (transient_pipeline)
+      c.begin_transient_pipeline();
+
+    std::string evicted;
+    const auto& name = c.statements().insert(query.c_str(), types, evicted);
+    auto prepare_sent = false;
+
+    try {
+      if (!evicted.empty())
+        send_close_prepared(evicted);
+
+      if (PQsendPrepare(c.underlying_handle(), name.c_str(), query.c_str(),
+            types.size, types.oids) != 1) {
+        throw std::runtime_error{
+          "error preparing query '" + std::string{query.c_str()} + "': " + std::string{c.last_error_message()}};
+      }
+
+      prepare_sent = true;
+
+      send_query_prepared_params(name, std::forward<Params>(params)...);
+    } catch (...) {
+      // The statement is not cached and the connection stays usable. If it
+      // has been sent, it is prepared under its unique name but never used.
+      if (prepare_sent)
+        c.enqueue(allocate_operation<discard_operation>(recycling_allocator<void>{c.recycler()}));
+
+      c.statements().erase(name);
+
+      if (transient_pipeline)
+        c.abort_transient_pipeline();
+
+      throw;
+    }
+
+    c.trace_send(query.c_str());
+
+    auto initiation = [this, &name, transient_pipeline](auto&& handler) {
+      using handler_t = std::decay_t<decltype(handler)>;
+      using exec_operation_t = prepared_exec_operation<handler_t>;
+
+      auto& c = derived().connection();
+
+      auto op = make_operation<exec_operation_t>(c.recycler(),
+          std::forward<decltype(handler)>(handler));
+      auto& prepare_error = static_cast<exec_operation_t&>(*op).prepare_error();
+
+      c.enqueue(allocate_operation<statement_prepare_operation>(
+            recycling_allocator<void>{c.recycler()}, c.statements(), name, prepare_error));
+
+      if (transient_pipeline)
+        c.end_transient_pipeline(std::move(op));
+      else
+        c.enqueue(std::move(op));
+    };
+
+    return boost::asio::async_initiate<
+      ResultCallableT, void(result_t)>(
+          initiation, handler);
+  }
+
+  /**
+   * Closes the prepared statement \p statement_name, ignoring the result.
+   * Sends DEALLOCATE instead of a Close message before libpq 17.
+   */
+  void send_close_prepared(const std::string& statement_name) {
+    auto& c = derived().connection();
+
+#ifdef LIBPQ_HAS_CLOSE_PREPARED
+    const auto res = PQsendClosePrepared(c.underlying_handle(), statement_name.c_str());
+#else
+    // Cached statement names are generated and need no quoting.
+    const auto query = "DEALLOCATE " + statement_name;
+    const auto res = PQsendQueryParams(c.underlying_handle(), query.c_str(),
+        0, nullptr, nullptr, nullptr, nullptr, 0);
+#endif
+
+    if (res != 1) {
+      throw std::runtime_error{
+        "error closing statement '" + statement_name + "': " + std::string{c.last_error_message()}};
+    }
+
+    c.enqueue(allocate_operation<discard_operation>(recycling_allocator<void>{c.recycler()}));
+  }
+
+  /**
+   * Executes the prepared statement \p statement_name with \p params bound
+   * to $1, $2, ... and queues \p handler to be called with its result.
+   */
+  template <class ResultCallableT, class... Params>
+  auto send_query_prepared(const std::string& statement_name,
+      ResultCallableT&& handler, Params&&... params) {
+    send_query_prepared_params(statement_name, std::forward<Params>(params)...);
+    derived().connection().trace_send(statement_name);
+
+    return handle_exec(std::forward<ResultCallableT>(handler));
+  }
+
+  /// Sends \p query with \p params bound to $1, $2, ...
+  template <class... Params>
+  void send_query_params(query_view query, Params&&... params) {
+    send_query_params(query, param_types{}, std::forward<Params>(params)...);
+  }
+
+  /// Same as above with the parameter types of \p query sent along.
+  template <class... Ts, class... Params>
+  void send_query_params(const static_query<Ts...>& query, Params&&... params) {
+    static_assert(static_query<Ts...>::template accepts<Params...>(),
+        "parameters do not match the types of the query");
+
+    send_query_params(query.c_str(), query.types(), std::forward<Params>(params)...);
+  }
+
+  /**
+   * Sends \p query with \p params bound to $1, $2, ..., declaring their
+   * types as \p types. The server infers the types not declared.
+   */
+  template <class... Params>
+  void send_query_params(query_view query, param_types types, Params&&... params) {
+    const utility::param_binding<Params...> binding{params...};
+
+    const auto res = PQsendQueryParams(derived().connection().underlying_handle(),
+        query.c_str(),
+        binding.size(),
+        binding.size() <= types.size ? types.oids : nullptr,
+        binding.values(),
+        binding.lengths(),
+        binding.formats(),
+        static_cast<int>(field_type::BINARY));
+
+    if (res != 1) {
+      throw std::runtime_error{
+        "error executing query '" + std::string{query.c_str()} + "': " + std::string{derived().connection().last_error_message()}};
+    }
+
+    trace_bytes(std::strlen(query.c_str()), binding);
+    derived().connection().trace_send(query.c_str());
+  }
+
+  /// Executes the prepared statement \p statement_name with \p params bound to $1, $2, ...
+  template <class... Params>
+  void send_query_prepared_params(const std::string& statement_name,
+      Params&&... params) {
+    const utility::param_binding<Params...> binding{params...};
+
+    const auto res = PQsendQueryPrepared(derived().connection().underlying_handle(),
+        statement_name.c_str(),
+        binding.size(),
+        binding.values(),
+        binding.lengths(),
+        binding.formats(),
+        static_cast<int>(field_type::BINARY));
+
+    if (res != 1) {
+      throw std::runtime_error{
+        "error executing query '" + statement_name + "': " + std::string{derived().connection().last_error_message()}};
+    }
+
+    trace_bytes(statement_name.size(), binding);
+  }
+
+  /**
+   * Prepares \p query as the unnamed statement and executes it with each
+   * tuple of parameters in \p param_sets, all behind a single synchronization
+   * point, and queues \p handler to be called with a \ref batch_result.
+   * Outside of pipeline mode, that is done in a transient pipeline.
+   */
+  template <class ParamSetRangeT, class BatchCallableT>
+  auto send_batch(query_view query, param_types types,
+      const ParamSetRangeT& param_sets, BatchCallableT&& handler) {
+    auto& c = derived().connection();
+    const auto transient_pipeline = !c.pipeline_mode();
+
+    if (transient_pipeline) {
+      if (c.busy())
+        throw std::runtime_error{"cannot execute a batch while other queries are in progress"};
+
+      c.begin_transient_pipeline();
+    }
+
+    const std::string unnamed;
+    auto prepare_sent = false;
+    std::size_t size = 0;
+
+    try {
+      if (PQsendPrepare(c.underlying_handle(), unnamed.c_str(), query.c_str(),
+            types.size, types.oids) != 1) {
+        throw std::runtime_error{
+          "error preparing query '" + std::string{query.c_str()} + "': " + std::string{c.last_error_message()}};
+      }
+
+      prepare_sent = true;
+
+      for (const auto& param_set : param_sets) {
+        std::apply([this, &unnamed](const auto&... params) {
+              send_query_prepared_params(unnamed, params...);
+            }, param_set);
+
+        ++size;
+      }
+    } catch (...) {
+      // The results of the queries already sent are discarded, so that the
+      // next results go to the operations they belong to.
+      if (prepare_sent) {
+        for (std::size_t i = 0; i <= size; ++i)
+          c.enqueue(allocate_operation<discard_operation>(recycling_allocator<void>{c.recycler()}));
+      }
+
+      if (transient_pipeline)
+        c.abort_transient_pipeline();
+
+      throw;
+    }
+
+    c.trace_send(query.c_str());
+
+    auto initiation = [this, size, transient_pipeline](auto&& handler) {
+      using handler_t = std::decay_t<decltype(handler)>;
+
+      auto& c = derived().connection();
+
+      auto op = make_operation<batch_operation<handler_t>>(c.recycler(),
+          std::forward<decltype(handler)>(handler), size);
+
+      if (transient_pipeline)
+        c.end_transient_pipeline(std::move(op));
+      else
+        c.enqueue(std::move(op));
+    };
+
+    return boost::asio::async_initiate<
+      BatchCallableT, void(batch_result)>(
+          initiation, handler);
+  }
+
+  /**
+   * Throws if the rows of the next query cannot be streamed. libpq applies
+   * the row mode to the oldest query whose results have not been read yet,
+   * so this must be checked before the query is sent.
+   */
+  void check_can_stream() {
+    if (derived().connection().busy())
+      throw std::runtime_error{"cannot stream rows while other queries are in progress"};
+  }
+
+  /**
+   * Makes the query that has just been sent return its rows in chunks of up
+   * to \p rows_per_chunk rows instead of a single result. Chunks of more than
+   * one row require libpq 17; with older versions, every chunk has one row.
+   * See \ref check_can_stream(). If the row mode cannot be set, the results
+   * of the query are discarded before this throws.
+   */
+  void set_rows_per_chunk([[maybe_unused]] std::size_t rows_per_chunk) {
+    auto& c = derived().connection();
+
+#ifdef LIBPQ_HAS_CHUNK_MODE
+    const auto res = rows_per_chunk > 1 ?
+      PQsetChunkedRowsMode(c.underlying_handle(), static_cast<int>(rows_per_chunk)) :
+      PQsetSingleRowMode(c.underlying_handle());
+#else
+    const auto res = PQsetSingleRowMode(c.underlying_handle());
+#endif
+
+    if (res != 1) {
+      const std::string message{c.last_error_message()};
+
+      c.enqueue(allocate_operation<discard_operation>(recycling_allocator<void>{c.recycler()}));
+
+      throw std::runtime_error{"could not set row mode: " + message};
+    }
+  }
+
+  /**
+   * Queues \p handler on the connection to be called with the single result
+   * of the query that has just been sent.
+   */
   template <class ResultCallableT>
   auto handle_exec(ResultCallableT&& handler) {
     auto initiation = [this](auto&& handler) {
-      auto wrapped_handler = [handler = std::move(handler),
-           r = std::make_shared<result>(nullptr)](auto&& res) mutable {
-        if (!res.done()) {
-          if (!r->done()) throw std::runtime_error{"expected one result"};
-          *r = std::move(res);
-        } else {
-          handler(std::move(*r));
-        }
-      };
+      using handler_t = std::decay_t<decltype(handler)>;
+
+      auto& c = derived().connection();
 
-      on_write_ready({});
-      wait_read_ready(std::move(wrapped_handler));
+      c.enqueue(make_operation<exec_operation<handler_t>>(c.recycler(),
+            std::forward<decltype(handler)>(handler)));
     };
 
     return boost::asio::async_initiate<
@@ -57,11 +400,19 @@ protected:
           initiation, handler);
   }
 
+  /**
+   * Queues \p handler on the connection to be called with each result of the
+   * query that has just been sent and once more with an empty result.
+   */
   template <class ResultCallableT>
   auto handle_exec_all(ResultCallableT&& handler) {
     auto initiation = [this](auto&& handler) {
-      on_write_ready({});
-      wait_read_ready(std::move(handler));
+      using handler_t = std::decay_t<decltype(handler)>;
+
+      auto& c = derived().connection();
+
+      c.enqueue(make_operation<exec_all_operation<handler_t>>(c.recycler(),
+            std::forward<decltype(handler)>(handler)));
     };
 
     return boost::asio::async_initiate<
@@ -69,55 +420,100 @@ protected:
           initiation, handler);
   }
 
-private:
-  template <class ResultCallableT>
-  void wait_read_ready(ResultCallableT&& handler) {
-    derived().socket().async_wait(std::decay_t<decltype(derived().socket())>::wait_read,
-        [this, handler = std::move(handler)](auto&& ec) mutable {
-          on_read_ready(std::move(handler), ec); });
+  /**
+   * Queues \p chunk_handler on the connection to be called with each chunk of
+   * rows of the query that has just been sent, and \p handler with the final
+   * result.
+   */
+  template <class ChunkCallableT, class ResultCallableT>
+  auto handle_exec_stream(ChunkCallableT&& chunk_handler, ResultCallableT&& handler) {
+    auto initiation = [this](auto&& handler, auto&& chunk_handler) {
+      using chunk_handler_t = std::decay_t<decltype(chunk_handler)>;
+      using handler_t = std::decay_t<decltype(handler)>;
+
+      auto& c = derived().connection();
+
+      const auto alloc = boost::asio::get_associated_allocator(handler,
+          recycling_allocator<void>{c.recycler()});
+
+      c.enqueue(allocate_operation<exec_stream_operation<chunk_handler_t, handler_t>>(
+            alloc, std::forward<decltype(chunk_handler)>(chunk_handler),
+            std::forward<decltype(handler)>(handler)));
+    };
+
+    return boost::asio::async_initiate<
+      ResultCallableT, void(result_t)>(
+          initiation, handler, std::forward<ChunkCallableT>(chunk_handler));
   }
 
-  void wait_write_ready() {
-    namespace ph = std::placeholders;
+  /**
+   * Queues \p handler on the connection to be called with the result of the
+   * COPY statement that has just been sent and \p value.
+   */
+  template <class CompletionTokenT, class ValueT>
+  auto handle_copy(CompletionTokenT&& handler, ValueT&& value) {
+    using value_t = std::decay_t<ValueT>;
+
+    auto initiation = [this](auto&& handler, auto&& value) {
+      using handler_t = std::decay_t<decltype(handler)>;
 
-    derived().socket().async_wait(std::decay_t<decltype(derived().socket())>::wait_write,
-        std::bind(&socket_operations::on_write_ready, this, ph::_1));
+      auto& c = derived().connection();
+
+      c.enqueue(make_operation<copy_operation<handler_t, value_t>>(
+            c.recycler(), std::forward<decltype(handler)>(handler),
+            std::forward<decltype(value)>(value)));
+    };
+
+    return boost::asio::async_initiate<
+      CompletionTokenT, void(result_t, value_t)>(
+          initiation, handler, std::forward<ValueT>(value));
   }
 
-  template <class ResultCallableT>
-  void on_read_ready(ResultCallableT&& handler, const error_code_t& ec) {
-    while (true) {
-      if (PQconsumeInput(derived().connection().underlying_handle()) != 1) {
-        // TODO: convert this to some kind of error via the callback
-        throw std::runtime_error{
-          "consume input failed: " + std::string{derived().connection().last_error_message()}};
-      }
+  /**
+   * Queues a reader on the connection for the COPY TO STDOUT statement that
+   * has just been sent. \p row_handler will be called with each row and
+   * \p handler with the result of the statement.
+   */
+  template <class RowCallableT, class ResultCallableT>
+  auto handle_copy_out(RowCallableT&& row_handler, ResultCallableT&& handler) {
+    auto initiation = [this](auto&& handler, auto&& row_handler) {
+      using connection_t = std::decay_t<decltype(derived().connection())>;
+      using reader_t = basic_copy_out_reader<connection_t,
+        std::decay_t<decltype(row_handler)>, std::decay_t<decltype(handler)>>;
 
-      if (!PQisBusy(derived().connection().underlying_handle())) {
-        const auto pqres = PQgetResult(derived().connection().underlying_handle());
+      auto start = [reader = reader_t{derived().connection(),
+          std::forward<decltype(row_handler)>(row_handler), std::forward<decltype(handler)>(handler)}](
+          result_t res) mutable {
+        reader.start(std::move(res));
+      };
 
-        result res{pqres};
-        handler(std::move(res));
+      auto& c = derived().connection();
 
-        if (!pqres) {
-          break;
-        }
-      } else {
-        wait_read_ready(std::forward<ResultCallableT>(handler));
-        break;
-      }
-    }
+      c.enqueue(make_operation<exec_operation<decltype(start)>>(c.recycler(), std::move(start)));
+    };
+
+    return boost::asio::async_initiate<
+      ResultCallableT, void(result_t)>(
+          initiation, handler, std::forward<RowCallableT>(row_handler));
   }
 
-  void on_write_ready(const error_code_t& ec) {
-    const auto ret = PQflush(derived().connection().underlying_handle());
-    if (ret == 1) {
-      wait_write_ready();
-    } else if (ret != 0) {
-      // TODO: ignore or convert this to some kind of error via the callback
-      throw std::runtime_error{
-        "flush failed: " + std::string{derived().connection().last_error_message()}};
-    }
+  /// Starts the trace of \p query, which has just been sent.
+  void trace_query(std::string_view query) {
+    derived().connection().trace_send(query);
+  }
+
+private:
+  /// Counts the bytes of a query for its trace, if tracing is enabled.
+  template <class BindingT>
+  void trace_bytes([[maybe_unused]] std::size_t query_size, [[maybe_unused]] const BindingT& binding) {
+#ifdef POSTGRESPP_TRACING
+    std::size_t size = query_size;
+
+    for (int i = 0; i < binding.size(); ++i)
+      size += static_cast<std::size_t>(binding.lengths()[i]);
+
+    derived().connection().trace_bytes(size);
+#endif
   }
 
   derived_t& derived() { return *static_cast<derived_t*>(this); }
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <boost/system/error_code.hpp>
+
+#include <type_traits>
+
+namespace postgrespp { namespace sqlstate {
+
+/**
+ * Encodes a SQLSTATE, five digits or upper case letters, as an int, or
+ * returns 0 if \p code is not one.
+ */
+constexpr int encode(const char* code) {
+  int value = 0;
+
+  for (int i = 0; i < 5; ++i) {
+    const auto c = code[i];
+
+    if (c >= '0' && c <= '9')
+      value = value * 36 + (c - '0');
+    else if (c >= 'A' && c <= 'Z')
+      value = value * 36 + (c - 'A' + 10);
+    else
+      return 0;
+  }
+
+  return code[5] == '\0' ? value : 0;
+}
+
+/// Some of the SQLSTATEs of PostgreSQL; any other can be made with \ref encode().
+enum errc {
+  unique_violation = encode("23505"),
+  foreign_key_violation = encode("23503"),
+  not_null_violation = encode("23502"),
+  check_violation = encode("23514"),
+  serialization_failure = encode("40001"),
+  deadlock_detected = encode("40P01"),
+  syntax_error = encode("42601"),
+  undefined_table = encode("42P01"),
+  undefined_column = encode("42703"),
+  query_canceled = encode("57014"),
+  admin_shutdown = encode("57P01"),
+};
+
+/// The category of error codes that hold an encoded SQLSTATE.
+const boost::system::error_category& get_category();
+
+inline boost::system::error_code make_error_code(errc e) {
+  return {static_cast<int>(e), get_category()};
+}
+
+/**
+ * Returns the error code of the SQLSTATE \p code. Successful completion,
+ * class 00, is no error.
+ */
+inline boost::system::error_code make_error_code(const char* code) {
+  const auto value = encode(code);
+
+  if (value < 36 * 36 * 36)
+    return {};
+
+  return {value, get_category()};
+}
+
+}}
+
+namespace boost { namespace system {
+
+template <>
+struct is_error_code_enum<::postgrespp::sqlstate::errc> : std::true_type {
+};
+
+}}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "type_oid.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace postgrespp {
+
+/**
+ * Maps query texts and the parameter types declared with them to the names of
+ * the statements prepared for them on a connection, evicting the least
+ * recently used statement when full. The same query with other declared
+ * types is another statement.
+ * See \ref basic_connection::set_statement_cache_capacity.
+ */
+class statement_cache {
+public:
+  using size_type = std::size_t;
+
+public:
+  explicit statement_cache(size_type capacity = 0);
+
+  statement_cache(const statement_cache&) = delete;
+  statement_cache(statement_cache&&) = default;
+
+  statement_cache& operator=(const statement_cache&) = delete;
+  statement_cache& operator=(statement_cache&&) = default;
+
+  size_type capacity() const { return capacity_; }
+
+  /// Throws if \p capacity is less than \ref size().
+  void set_capacity(size_type capacity);
+
+  size_type size() const { return entries_.size(); }
+
+  /**
+   * Returns the name of the statement prepared for \p query with \p types
+   * and marks it as the most recently used, or nullptr if there is none.
+   * Does not allocate.
+   */
+  const std::string* find(const char* query, param_types types);
+
+  /**
+   * Adds \p query with \p types and a new statement name and returns the
+   * name. If the cache is full, the least recently used statement is removed
+   * and its name is moved into \p evicted, which is left empty otherwise.
+   */
+  const std::string& insert(const char* query, param_types types, std::string& evicted);
+
+  /// Removes the statement named \p name, e.g. because preparing it failed.
+  void erase(const std::string& name);
+
+private:
+  struct entry {
+    std::string query;
+    std::vector<Oid> types;
+    std::string name;
+  };
+
+  /// Refers to a query and its types, either those of an entry or looked up.
+  struct key {
+    std::string_view query;
+    param_types types;
+
+    bool operator==(const key& rhs) const;
+  };
+
+  struct key_hash {
+    std::size_t operator()(const key& k) const;
+  };
+
+  using entries_t = std::list<entry>;
+
+private:
+  static key key_of(const entry& e) {
+    return {e.query, {e.types.data(), static_cast<int>(e.types.size())}};
+  }
+
+private:
+  size_type capacity_;
+
+  /// Most recently used first.
+  entries_t entries_;
+
+  /// Keys refer to the queries and types in \ref entries_.
+  std::unordered_map<key, entries_t::iterator, key_hash> index_;
+
+  std::uint64_t next_id_ = 0;
+};
+
+}
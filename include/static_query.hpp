@@ -0,0 +1,67 @@
+#pragma once
+
+#include "type_oid.hpp"
+
+#include <libpq-fe.h>
+
+#include <array>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace postgrespp {
+
+/**
+ * A query whose parameters $1, $2, ... have the types \p Ts. The OIDs of the
+ * parameters are sent along with the query, so the server does not infer
+ * them, and passing parameters of other types fails to compile.
+ *
+ * \code
+ * constexpr static_query<std::int64_t, std::string> q{
+ *   "SELECT * FROM tbl_test WHERE bi = $1 AND t = $2"};
+ *
+ * txn.async_exec(q, handler, std::int64_t{40}, "row 0");
+ * \endcode
+ */
+template <class... Ts>
+class static_query {
+public:
+  static constexpr std::array<Oid, sizeof...(Ts)> oids{{type_oid_v<Ts>...}};
+
+public:
+  constexpr explicit static_query(const char* query) noexcept
+    : query_{query} {
+  }
+
+  constexpr const char* c_str() const noexcept { return query_; }
+
+  static constexpr param_types types() noexcept {
+    return {oids.data(), static_cast<int>(sizeof...(Ts))};
+  }
+
+  /// True if \p Params are encoded as the types \p Ts.
+  template <class... Params>
+  static constexpr bool accepts() {
+    if constexpr (sizeof...(Params) != sizeof...(Ts))
+      return false;
+    else
+      return ((type_oid_v<std::decay_t<Params>> == type_oid_v<Ts>) && ...);
+  }
+
+  /// True if the elements of the tuple \p ParamSetT are encoded as the types \p Ts.
+  template <class ParamSetT>
+  static constexpr bool accepts_param_set() {
+    return accepts_param_set<ParamSetT>(std::make_index_sequence<std::tuple_size_v<ParamSetT>>{});
+  }
+
+private:
+  template <class ParamSetT, std::size_t... Is>
+  static constexpr bool accepts_param_set(std::index_sequence<Is...>) {
+    return accepts<std::tuple_element_t<Is, ParamSetT>...>();
+  }
+
+private:
+  const char* query_;
+};
+
+}
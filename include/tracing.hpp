@@ -0,0 +1,133 @@
+#pragma once
+
+#include "latency_histogram.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace postgrespp { namespace tracing {
+
+using clock = std::chrono::steady_clock;
+
+/**
+ * The timeline of a query on a connection. Only collected when the library
+ * and the code using it are compiled with POSTGRESPP_TRACING defined, see
+ * \ref basic_connection::set_tracer().
+ */
+struct query_trace {
+  /// Set for queries that are traced.
+  bool traced = false;
+
+  /// The ID returned by \ref tracer::on_send() for the query.
+  std::uint32_t statement = 0;
+
+  /// When the query was queued to be sent.
+  clock::time_point sent;
+
+  /// When data for the query was first available on the connection.
+  clock::time_point first_byte;
+
+  /// When its last result was received.
+  clock::time_point result_ready;
+
+  /// When its handler was called, or dispatched to its executor.
+  clock::time_point dispatched;
+
+  /// When the call to its handler returned, or it was dispatched.
+  clock::time_point completed;
+
+  /// Size of the query text and parameters.
+  std::size_t bytes_sent = 0;
+
+  /// Memory taken by the results, see PQresultMemorySize.
+  std::size_t bytes_received = 0;
+
+  std::size_t rows = 0;
+};
+
+/**
+ * Receives the traces of the queries of connections. It is called on the
+ * executors of the connections, so a tracer shared by connections on several
+ * threads must be thread safe.
+ */
+class tracer {
+public:
+  virtual ~tracer() = default;
+
+  /**
+   * Called when \p query, or the name of a prepared statement, is sent.
+   * Returns an ID passed back as \ref query_trace::statement.
+   */
+  virtual std::uint32_t on_send(std::string_view query) = 0;
+
+  /// Called once the handler of a query has been called.
+  virtual void on_complete(const query_trace& trace) = 0;
+};
+
+/**
+ * Keeps latency histograms per statement, which can be read at any time:
+ * - server: from sending to the first byte, the network and server time,
+ * - receive: from the first byte to the last result, the transfer time,
+ * - handler: the time spent in the handler, e.g. decoding,
+ * - total: from sending to the handler returning.
+ *
+ * Statements are kept in a table of fixed capacity and recording is lock
+ * free; queries are not counted once the table is full.
+ */
+class statement_tracer : public tracer {
+public:
+  struct statistics {
+    latency_histogram server;
+    latency_histogram receive;
+    latency_histogram handler;
+    latency_histogram total;
+    std::atomic<std::uint64_t> rows{0};
+    std::atomic<std::uint64_t> bytes_sent{0};
+    std::atomic<std::uint64_t> bytes_received{0};
+  };
+
+public:
+  explicit statement_tracer(std::size_t capacity = 256);
+
+  statement_tracer(const statement_tracer&) = delete;
+  statement_tracer& operator=(const statement_tracer&) = delete;
+
+  ~statement_tracer() override;
+
+  std::uint32_t on_send(std::string_view query) override;
+
+  void on_complete(const query_trace& trace) override;
+
+  /// Returns the statistics of \p query, or nullptr if it was not sent.
+  const statistics* find(std::string_view query) const;
+
+  /// Calls \p f with each statement and its \ref statistics.
+  template <class CallableT>
+  void for_each(CallableT&& f) const {
+    for (std::size_t i = 0; i < capacity_; ++i) {
+      if (const auto stats = slots_[i].stats.load(std::memory_order_acquire))
+        f(std::string_view{slots_[i].query}, *stats);
+    }
+  }
+
+private:
+  struct slot {
+    std::atomic<std::uint64_t> hash{0};
+    std::atomic<statistics*> stats{nullptr};
+
+    /// Written once before stats is published.
+    std::string query;
+  };
+
+  static std::uint64_t hash_of(std::string_view query);
+
+private:
+  const std::size_t capacity_;
+  std::unique_ptr<slot[]> slots_;
+};
+
+}}
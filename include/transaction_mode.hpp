@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <type_traits>
+
+namespace postgrespp {
+
+/// The RWT of a \ref basic_transaction that may write. Same as void.
+struct read_write {
+};
+
+/// The RWT of a \ref basic_transaction that only reads.
+struct read_only {
+};
+
+/**
+ * The RWT of a \ref basic_transaction that only reads and is DEFERRABLE.
+ * Together with \ref serializable, it waits for a snapshot on which it
+ * cannot fail with a serialization failure. SERIALIZABLE is not available
+ * on read replicas.
+ */
+struct deferrable {
+};
+
+/// The IsolationT of a \ref basic_transaction. void uses the default of the server.
+struct read_committed {
+};
+
+/// See \ref read_committed.
+struct repeatable_read {
+};
+
+/// See \ref read_committed.
+struct serializable {
+};
+
+template <class RWT>
+constexpr bool is_read_only_v = std::is_same_v<RWT, read_only> || std::is_same_v<RWT, deferrable>;
+
+namespace detail {
+
+template <class T>
+constexpr bool dependent_false_v = false;
+
+template <class RWT>
+constexpr const char* access_mode() {
+  if constexpr (std::is_same_v<RWT, void> || std::is_same_v<RWT, read_write>)
+    return "";
+  else if constexpr (std::is_same_v<RWT, read_only>)
+    return "READ ONLY";
+  else if constexpr (std::is_same_v<RWT, deferrable>)
+    return "READ ONLY, DEFERRABLE";
+  else
+    static_assert(dependent_false_v<RWT>, "unknown transaction access mode");
+}
+
+template <class IsolationT>
+constexpr const char* isolation_level() {
+  if constexpr (std::is_same_v<IsolationT, void>)
+    return "";
+  else if constexpr (std::is_same_v<IsolationT, read_committed>)
+    return "ISOLATION LEVEL READ COMMITTED";
+  else if constexpr (std::is_same_v<IsolationT, repeatable_read>)
+    return "ISOLATION LEVEL REPEATABLE READ";
+  else if constexpr (std::is_same_v<IsolationT, serializable>)
+    return "ISOLATION LEVEL SERIALIZABLE";
+  else
+    static_assert(dependent_false_v<IsolationT>, "unknown transaction isolation level");
+}
+
+}
+
+/**
+ * The statement that starts a transaction of \p RWT and \p IsolationT, e.g.
+ * "BEGIN ISOLATION LEVEL SERIALIZABLE, READ ONLY".
+ */
+template <class RWT, class IsolationT>
+const char* begin_statement() {
+  static const std::string statement = [] {
+    const std::string isolation = detail::isolation_level<IsolationT>();
+    const std::string access = detail::access_mode<RWT>();
+
+    std::string s = "BEGIN";
+
+    if (!isolation.empty())
+      s += " " + isolation;
+
+    if (!access.empty())
+      s += (isolation.empty() ? " " : ", ") + access;
+
+    return s;
+  }();
+
+  return statement.c_str();
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <libpq-fe.h>
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace postgrespp {
+
+/**
+ * The OID of the PostgreSQL type that \p T is encoded as in binary format.
+ * Not defined for types without one.
+ */
+template <class T, class Enable = void>
+struct type_oid;
+
+template <class T>
+struct type_oid<T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 2>>
+  : std::integral_constant<Oid, 21> {  // int2
+};
+
+template <class T>
+struct type_oid<T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 4>>
+  : std::integral_constant<Oid, 23> {  // int4
+};
+
+template <class T>
+struct type_oid<T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 8>>
+  : std::integral_constant<Oid, 20> {  // int8
+};
+
+template <>
+struct type_oid<float, void> : std::integral_constant<Oid, 700> {  // float4
+};
+
+template <>
+struct type_oid<double, void> : std::integral_constant<Oid, 701> {  // float8
+};
+
+template <>
+struct type_oid<std::string, void> : std::integral_constant<Oid, 25> {  // text
+};
+
+template <>
+struct type_oid<const char*, void> : std::integral_constant<Oid, 25> {  // text
+};
+
+template <>
+struct type_oid<char*, void> : type_oid<const char*> {
+};
+
+template <class T>
+constexpr Oid type_oid_v = type_oid<T>::value;
+
+template <class T, class Enable = void>
+struct has_type_oid : std::false_type {
+};
+
+template <class T>
+struct has_type_oid<T, std::void_t<decltype(type_oid<T>::value)>> : std::true_type {
+};
+
+/// The OIDs of the parameters of a query, or none to let the server infer them.
+struct param_types {
+  const Oid* oids = nullptr;
+  int size = 0;
+};
+
+}
@@ -2,29 +2,53 @@
 
 #include "type_encoder.hpp"
 
+#include <array>
 #include <tuple>
+#include <type_traits>
 
 namespace postgrespp { namespace utility {
 
-template <class... Params>
-std::tuple<typename type_encoder<Params>::encoder_t::value_t...>
-create_value_holders(Params&&... params) {
-  return std::make_tuple(typename type_encoder<Params>::encoder_t{}.to_text_value(params)...);
-}
-
 template <class... Params>
 std::array<const char*, sizeof...(Params)> value_array(Params&&... params) {
   return {typename type_encoder<Params>::encoder_t{}.c_str(params)...};
 }
 
+/**
+ * The values, lengths and formats of \p Params as PQsendQueryParams takes
+ * them. Each parameter is encoded once into storage held by the binding
+ * itself; strings are referred to where they are. Binding therefore does not
+ * allocate unless an encoder does.
+ */
 template <class... Params>
-std::array<int, sizeof...(Params)> size_array(Params&&... params) {
-  return {static_cast<int>(typename type_encoder<Params>::encoder_t{}.size(params))...};
-}
+class param_binding {
+private:
+  template <class Param>
+  using encoder_t = typename type_encoder<const std::remove_reference_t<Param>&>::encoder_t;
 
-template <class... Params>
-std::array<int, sizeof...(Params)> type_array(Params&&... params) {
-  return {typename type_encoder<Params>::encoder_t{}.type(params)...};
-}
+public:
+  explicit param_binding(const std::remove_reference_t<Params>&... params)
+    : holders_{encoder_t<Params>{}.to_text_value(params)...}
+    , lengths_{{static_cast<int>(encoder_t<Params>{}.size(params))...}}
+    , formats_{{encoder_t<Params>{}.type(params)...}} {
+    values_ = std::apply([](const auto&... holders) { return value_array(holders...); }, holders_);
+  }
+
+  param_binding(const param_binding&) = delete;
+  param_binding& operator=(const param_binding&) = delete;
+
+  int size() const { return static_cast<int>(sizeof...(Params)); }
+
+  const char* const* values() const { return values_.data(); }
+
+  const int* lengths() const { return lengths_.data(); }
+
+  const int* formats() const { return formats_.data(); }
+
+private:
+  std::tuple<typename encoder_t<Params>::value_t...> holders_;
+  std::array<const char*, sizeof...(Params)> values_;
+  std::array<int, sizeof...(Params)> lengths_;
+  std::array<int, sizeof...(Params)> formats_;
+};
 
 }}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "batch_result.hpp"
+#include "result.hpp"
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <type_traits>
+#include <utility>
+
+namespace postgrespp {
+
+/**
+ * A completion token that passes the error code of the result to the handler
+ * before the result.
+ */
+template <class CompletionTokenT>
+class error_code_token {
+public:
+  explicit error_code_token(CompletionTokenT token)
+    : token_{std::move(token)} {
+  }
+
+  CompletionTokenT& token() { return token_; }
+
+private:
+  CompletionTokenT token_;
+};
+
+/**
+ * Adapts \p token so that handlers of \ref result and \ref batch_result take
+ * a boost::system::error_code first: success if the query succeeded and
+ * \ref result::error_code() otherwise. This lets the operations be used
+ * with tokens and coroutines that act on error codes, e.g. redirect_error.
+ *
+ * \code
+ * async_exec(c, "SELECT 1", with_error_code([](auto ec, auto&& result) {
+ *   if (ec == sqlstate::serialization_failure) ...
+ * }));
+ * \endcode
+ */
+template <class CompletionTokenT>
+auto with_error_code(CompletionTokenT&& token) {
+  return error_code_token<std::decay_t<CompletionTokenT>>{std::forward<CompletionTokenT>(token)};
+}
+
+namespace detail {
+
+inline boost::system::error_code error_code_of(const result& res) {
+  return res.done() ? boost::system::error_code{} : res.error_code();
+}
+
+inline boost::system::error_code error_code_of(const batch_result& res) {
+  return res.ok() ? boost::system::error_code{} : res.error().error_code();
+}
+
+/// Calls the handler with the error code of the result first.
+template <class HandlerT>
+class error_code_handler {
+public:
+  explicit error_code_handler(HandlerT&& handler)
+    : handler_{std::move(handler)} {
+  }
+
+  template <class ResultT, class... Args>
+  void operator()(ResultT&& res, Args&&... args) {
+    const auto ec = error_code_of(res);
+
+    handler_(ec, std::forward<ResultT>(res), std::forward<Args>(args)...);
+  }
+
+  const HandlerT& handler() const { return handler_; }
+
+private:
+  HandlerT handler_;
+};
+
+}
+
+}
+
+namespace boost { namespace asio {
+
+template <class HandlerT, class ExecutorT>
+struct associated_executor<::postgrespp::detail::error_code_handler<HandlerT>, ExecutorT> {
+  using type = associated_executor_t<HandlerT, ExecutorT>;
+
+  static type get(const ::postgrespp::detail::error_code_handler<HandlerT>& h,
+      const ExecutorT& exc = ExecutorT{}) noexcept {
+    return get_associated_executor(h.handler(), exc);
+  }
+};
+
+template <class HandlerT, class AllocatorT>
+struct associated_allocator<::postgrespp::detail::error_code_handler<HandlerT>, AllocatorT> {
+  using type = associated_allocator_t<HandlerT, AllocatorT>;
+
+  static type get(const ::postgrespp::detail::error_code_handler<HandlerT>& h,
+      const AllocatorT& alloc = AllocatorT{}) noexcept {
+    return get_associated_allocator(h.handler(), alloc);
+  }
+};
+
+template <class CompletionTokenT, class ResultT, class... Args>
+class async_result<::postgrespp::error_code_token<CompletionTokenT>, void(ResultT, Args...)> {
+  using signature_t = void(boost::system::error_code, ResultT, Args...);
+
+public:
+  using return_type = typename async_result<CompletionTokenT, signature_t>::return_type;
+
+  template <class InitiationT, class RawCompletionTokenT, class... InitArgs>
+  static return_type initiate(InitiationT&& initiation, RawCompletionTokenT&& token, InitArgs&&... args) {
+    return async_initiate<CompletionTokenT, signature_t>(
+        [initiation = std::forward<InitiationT>(initiation)](auto&& handler, auto&&... args) mutable {
+          using handler_t = std::decay_t<decltype(handler)>;
+
+          std::move(initiation)(
+              ::postgrespp::detail::error_code_handler<handler_t>{std::move(handler)},
+              std::forward<decltype(args)>(args)...);
+        },
+        token.token(), std::forward<InitArgs>(args)...);
+  }
+};
+
+}}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "basic_connection.hpp"
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace postgrespp {
+
+/// A completion token that cancels the query if it does not complete in time.
+template <class CompletionTokenT>
+class timeout_token {
+public:
+  using duration_t = std::chrono::steady_clock::duration;
+
+public:
+  timeout_token(basic_connection& c, duration_t timeout, CompletionTokenT token)
+    : c_{c}
+    , timeout_{timeout}
+    , token_{std::move(token)} {
+  }
+
+  basic_connection& connection() const { return c_; }
+
+  duration_t timeout() const { return timeout_; }
+
+  CompletionTokenT& token() { return token_; }
+
+private:
+  basic_connection& c_;
+  duration_t timeout_;
+  CompletionTokenT token_;
+};
+
+/**
+ * Adapts \p token so that the query on \p c is cancelled with
+ * \ref basic_connection::async_cancel() if it has not completed after
+ * \p timeout. The handler is then called with the error of the cancelled
+ * query, SQLSTATE 57014.
+ *
+ * Only a query that the server is running and whose results have not
+ * started to arrive is cancelled. A query queued behind others, or whose
+ * results are arriving, is left to complete: its handler is called with
+ * \ref error::timed_out right away and its results are discarded when they
+ * arrive. The rows of a COPY TO STDOUT still reach the row handler. If the
+ * handler takes more than a result, e.g. for a COPY FROM STDIN, it is called
+ * with \ref error::timed_out once the query completes instead, unless the
+ * COPY has started.
+ *
+ * \code
+ * async_exec(c, "SELECT pg_sleep(10)",
+ *     with_timeout(c, std::chrono::seconds{1}, [](auto&& result) { ... }));
+ * \endcode
+ *
+ * The cancel request is delivered separately from the query. If the query
+ * completes in the meantime, the request cancels whatever the server runs
+ * next on the connection, in pipeline mode the next query, which may have no
+ * timeout. A cancelled query in pipeline mode aborts the queries after it up
+ * to the next synchronization point.
+ *
+ * If the connection is destroyed first, the timer is stopped.
+ */
+template <class CompletionTokenT>
+auto with_timeout(basic_connection& c, std::chrono::steady_clock::duration timeout,
+    CompletionTokenT&& token) {
+  return timeout_token<std::decay_t<CompletionTokenT>>{c, timeout, std::forward<CompletionTokenT>(token)};
+}
+
+namespace detail {
+
+/**
+ * The handler of an operation with a timeout and its timer, shared by the
+ * operation and the timer so that either can complete it.
+ */
+template <class HandlerT>
+struct timeout_state {
+  template <class H, class ExecutorT>
+  timeout_state(H&& handler, const ExecutorT& exc)
+    : handler{std::forward<H>(handler)}
+    , timer{exc} {
+  }
+
+  /// True for the first caller only, which completes the operation.
+  bool claim() { return !done.exchange(true); }
+
+  HandlerT handler;
+  boost::asio::steady_timer timer;
+  std::atomic<bool> done{false};
+
+  /// Timed out without being cancelled or completed, see \ref timeout_handler.
+  std::atomic<bool> expired{false};
+};
+
+/**
+ * Stops the timer of the operation before calling the handler, with
+ * \ref error::timed_out if it has expired. Does nothing if the timer has
+ * completed the operation already. The timer is stopped as well if the
+ * operation is destroyed without completing, e.g. with its connection.
+ */
+template <class HandlerT>
+class timeout_handler {
+public:
+  explicit timeout_handler(std::shared_ptr<timeout_state<HandlerT>> state)
+    : state_{std::move(state)} {
+  }
+
+  timeout_handler(const timeout_handler&) = delete;
+  timeout_handler(timeout_handler&&) = default;
+
+  timeout_handler& operator=(const timeout_handler&) = delete;
+  timeout_handler& operator=(timeout_handler&&) = default;
+
+  ~timeout_handler() {
+    // The timer must not reach the connection, which may be gone.
+    if (state_ && state_->claim())
+      state_->timer.cancel();
+  }
+
+  template <class... Args>
+  void operator()(Args&&... args) {
+    if (!state_->claim())
+      return;
+
+    // The handler may run on another executor than the timer.
+    boost::asio::post(state_->timer.get_executor(), [state = state_] { state->timer.cancel(); });
+
+    call(std::forward<Args>(args)...);
+  }
+
+  const HandlerT& handler() const { return state_->handler; }
+
+private:
+  template <class FirstT, class... Args>
+  void call(FirstT&& first, Args&&... args) {
+    if constexpr (std::is_same_v<std::decay_t<FirstT>, result>) {
+      // The end of the results and a COPY in progress are passed on as is.
+      if (state_->expired && !first.done() && !first.copying())
+        return state_->handler(result::make_error(error::timed_out), std::forward<Args>(args)...);
+    }
+
+    state_->handler(std::forward<FirstT>(first), std::forward<Args>(args)...);
+  }
+
+  void call() { state_->handler(); }
+
+private:
+  std::shared_ptr<timeout_state<HandlerT>> state_;
+};
+
+}
+
+}
+
+namespace boost { namespace asio {
+
+template <class HandlerT, class ExecutorT>
+struct associated_executor<::postgrespp::detail::timeout_handler<HandlerT>, ExecutorT> {
+  using type = associated_executor_t<HandlerT, ExecutorT>;
+
+  static type get(const ::postgrespp::detail::timeout_handler<HandlerT>& h,
+      const ExecutorT& exc = ExecutorT{}) noexcept {
+    return get_associated_executor(h.handler(), exc);
+  }
+};
+
+template <class HandlerT, class AllocatorT>
+struct associated_allocator<::postgrespp::detail::timeout_handler<HandlerT>, AllocatorT> {
+  using type = associated_allocator_t<HandlerT, AllocatorT>;
+
+  static type get(const ::postgrespp::detail::timeout_handler<HandlerT>& h,
+      const AllocatorT& alloc = AllocatorT{}) noexcept {
+    return get_associated_allocator(h.handler(), alloc);
+  }
+};
+
+template <class CompletionTokenT, class Signature>
+class async_result<::postgrespp::timeout_token<CompletionTokenT>, Signature> {
+public:
+  using return_type = typename async_result<CompletionTokenT, Signature>::return_type;
+
+  template <class InitiationT, class RawCompletionTokenT, class... Args>
+  static return_type initiate(InitiationT&& initiation, RawCompletionTokenT&& token, Args&&... args) {
+    auto& c = token.connection();
+    const auto timeout = token.timeout();
+
+    return async_initiate<CompletionTokenT, Signature>(
+        [initiation = std::forward<InitiationT>(initiation), &c, timeout](auto&& handler, auto&&... args) mutable {
+          using handler_t = std::decay_t<decltype(handler)>;
+
+          auto state = std::make_shared<::postgrespp::detail::timeout_state<handler_t>>(
+              std::forward<decltype(handler)>(handler), c.get_executor());
+
+          const auto before = c.last_operation();
+
+          std::move(initiation)(
+              ::postgrespp::detail::timeout_handler<handler_t>{state},
+              std::forward<decltype(args)>(args)...);
+
+          // The operation queued for the query, if the initiation queued one.
+          const auto last = c.last_operation();
+          const auto op = last != before ? last : 0;
+
+          state->timer.expires_after(timeout);
+          state->timer.async_wait([&c, state, op](const boost::system::error_code& ec) {
+                // Done also once the operation is destroyed with the connection.
+                if (ec || state->done)
+                  return;
+
+                if (c.cancel_running(op))
+                  return;
+
+                if constexpr (std::is_same_v<Signature, void(::postgrespp::result)>) {
+                  // Completed now rather than after the queries before it,
+                  // the handler stays in place for the operation to ignore.
+                  if (state->claim()) {
+                    boost::asio::dispatch(get_associated_executor(state->handler), [state] {
+                          state->handler(::postgrespp::result::make_error(::postgrespp::error::timed_out));
+                        });
+                  }
+                } else {
+                  state->expired = true;
+                }
+              });
+        },
+        token.token(), std::forward<Args>(args)...);
+  }
+};
+
+}}
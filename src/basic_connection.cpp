@@ -1,8 +1,11 @@
 #include <basic_connection.hpp>
 #include <work.hpp>
 
+#include <boost/asio/error.hpp>
 #include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/post.hpp>
 
+#include <functional>
 #include <memory>
 #include <thread>
 
@@ -16,13 +19,239 @@ std::shared_ptr<std::thread> ioc_thread{
   [](std::thread* thread) { ioc.stop(); thread->join(); delete thread; }
 };
 
+#ifdef LIBPQ_HAS_ASYNC_CANCEL
+
+/// Sends a cancel request without blocking, like PQconnectStart/Poll.
+class cancel_operation : public std::enable_shared_from_this<cancel_operation> {
+public:
+  using socket_t = basic_connection::socket_t;
+
+public:
+  cancel_operation(const socket_t::executor_type& exc, PGcancelConn* c,
+      std::function<void(const boost::system::error_code&)> handler)
+    : socket_{exc}
+    , c_{c}
+    , handler_{std::move(handler)} {
+  }
+
+  ~cancel_operation() {
+    // the descriptor is owned and closed by libpq.
+    if (socket_.is_open())
+      socket_.release();
+
+    if (c_)
+      PQcancelFinish(c_);
+  }
+
+  void start() {
+    if (!c_ || PQcancelStart(c_) != 1) {
+      finish(error::cancel_failed);
+      return;
+    }
+
+    poll(PGRES_POLLING_WRITING);
+  }
+
+private:
+  void poll(PostgresPollingStatusType status) {
+    switch (status) {
+      case PGRES_POLLING_READING:
+        wait(socket_t::wait_read);
+        break;
+      case PGRES_POLLING_WRITING:
+        wait(socket_t::wait_write);
+        break;
+      case PGRES_POLLING_OK:
+        finish({});
+        break;
+      default:
+        finish(error::cancel_failed);
+        break;
+    }
+  }
+
+  void wait(socket_t::wait_type wait) {
+    const auto socket = PQcancelSocket(c_);
+
+    if (socket < 0) {
+      finish(error::cancel_failed);
+      return;
+    }
+
+    if (socket_.is_open())
+      socket_.release();
+
+    socket_.assign(boost::asio::ip::tcp::v4(), socket);
+
+    socket_.async_wait(wait, [self = shared_from_this()](const auto& ec) {
+          if (ec)
+            self->finish(ec);
+          else
+            self->poll(PQcancelPoll(self->c_));
+        });
+  }
+
+  void finish(const boost::system::error_code& ec) {
+    boost::asio::post(socket_.get_executor(), [handler = std::move(handler_), ec] { handler(ec); });
+  }
+
+private:
+  socket_t socket_;
+  PGcancelConn* c_;
+  std::function<void(const boost::system::error_code&)> handler_;
+};
+
+#endif
+
+#ifdef POSTGRESPP_TRACING
+
+/// Marks the first data received for the query of \p op.
+void trace_received(pending_operation& op) {
+  if (op.trace.traced && op.trace.first_byte == tracing::clock::time_point{})
+    op.trace.first_byte = tracing::clock::now();
+}
+
+/// Counts the rows and memory of \p res.
+void trace_result(pending_operation& op, const PGresult* res) {
+  op.trace.rows += static_cast<std::size_t>(PQntuples(res));
+  op.trace.bytes_received += PQresultMemorySize(res);
+}
+
+/// Marks the time the last result of \p op was received.
+void trace_done(pending_operation& op) {
+  op.trace.result_ready = tracing::clock::now();
+}
+
+#endif
+
 }
 
 basic_connection::~basic_connection() {
+  // the descriptor is owned and closed by libpq.
+  if (socket_.is_open())
+    socket_.release();
+
+  if (const auto waiter = std::move(notification_waiter_))
+    waiter->complete(boost::asio::error::operation_aborted, {});
+
   if (c_)
     PQfinish(c_);
 }
 
+void basic_connection::enter_pipeline_mode() {
+  exit_pipeline_scheduled_ = false;
+
+  if (PQenterPipelineMode(c_) != 1)
+    throw std::runtime_error{"could not enter pipeline mode: " + std::string{last_error_message()}};
+}
+
+void basic_connection::exit_pipeline_mode() {
+  if (!try_exit_pipeline_mode())
+    throw std::runtime_error{"could not exit pipeline mode: " + std::string{last_error_message()}};
+}
+
+bool basic_connection::try_exit_pipeline_mode() {
+  if (!pending_.empty() || sync_scheduled_) {
+    exit_pipeline_scheduled_ = true;
+    return true;
+  }
+
+  exit_pipeline_scheduled_ = false;
+
+  return PQexitPipelineMode(c_) == 1;
+}
+
+void basic_connection::begin_transient_pipeline() {
+  enter_pipeline_mode();
+
+  transient_pipeline_ = true;
+  transient_open_ = true;
+}
+
+void basic_connection::end_transient_pipeline(pending_operation::ptr last) {
+  enqueue(std::move(last));
+
+  sync_transient_pipeline();
+}
+
+void basic_connection::sync_transient_pipeline() {
+  transient_open_ = false;
+  transient_last_ = &pending_.back();
+
+  if (PQpipelineSync(c_) != 1) {
+    throw std::runtime_error{
+      "pipeline sync failed: " + std::string{last_error_message()}};
+  }
+
+  pending_.push(allocate_operation<pipeline_sync_operation>(
+        recycling_allocator<void>{recycler()}));
+  on_write_ready({});
+}
+
+void basic_connection::abort_transient_pipeline() {
+  if (pending_.empty()) {
+    transient_pipeline_ = transient_open_ = false;
+    PQexitPipelineMode(c_);
+  } else {
+    sync_transient_pipeline();
+  }
+}
+
+void basic_connection::cancel(cancel_handler_t handler) {
+#ifdef LIBPQ_HAS_ASYNC_CANCEL
+  std::make_shared<cancel_operation>(socket_.get_executor(), PQcancelCreate(c_), std::move(handler))->start();
+#else
+  const auto cancel = PQgetCancel(c_);
+
+  if (!cancel) {
+    boost::asio::post(socket_.get_executor(), [handler = std::move(handler)] {
+          handler(error::cancel_failed);
+        });
+    return;
+  }
+
+  // PQcancel blocks until the request is delivered, so it is sent from a
+  // thread of its own rather than one shared by other connections.
+  std::thread{[cancel, exc = socket_.get_executor(), handler = std::move(handler)]() mutable {
+        char error_buffer[256];
+        const auto delivered = PQcancel(cancel, error_buffer, sizeof(error_buffer)) == 1;
+
+        PQfreeCancel(cancel);
+
+        boost::asio::post(exc, [handler = std::move(handler), delivered] {
+              handler(delivered ? boost::system::error_code{} : error::cancel_failed);
+            });
+      }}.detach();
+#endif
+}
+
+bool basic_connection::cancel_running(operation_queue::id_type id) {
+  if (pending_.empty() || pending_.front_id() != id || receiving_ == id)
+    return false;
+
+  cancel([](const boost::system::error_code&) {});
+
+  return true;
+}
+
+bool basic_connection::pipeline_mode() const {
+  return PQpipelineStatus(c_) != PQ_PIPELINE_OFF;
+}
+
+bool basic_connection::assign_socket() {
+  const auto socket = PQsocket(c_);
+
+  if (socket < 0)
+    return false;
+
+  if (socket_.is_open())
+    socket_.release();
+
+  socket_.assign(boost::asio::ip::tcp::v4(), socket);
+
+  return true;
+}
+
 int basic_connection::status() const {
   return PQstatus(c_);
 }
@@ -31,4 +260,344 @@ auto basic_connection::standalone_ioc() -> io_context_t& {
   return ioc;
 }
 
+void basic_connection::enqueue(pending_operation::ptr op) {
+#ifdef POSTGRESPP_TRACING
+  if (next_trace_.traced && op->traced()) {
+    op->trace = next_trace_;
+    next_trace_ = {};
+  }
+#endif
+
+  pending_.push(std::move(op));
+
+  // Queries sent while a transient pipeline is in progress but already
+  // synced need a sync of their own.
+  if (pipeline_mode() && !transient_open_) {
+    schedule_pipeline_sync();
+  } else {
+    on_write_ready({});
+  }
+
+  if (!reading_) {
+    reading_ = true;
+    wait_read_ready();
+  }
+}
+
+void basic_connection::schedule_pipeline_sync() {
+  if (sync_scheduled_)
+    return;
+
+  sync_scheduled_ = true;
+
+  boost::asio::post(socket_.get_executor(), [this] {
+        sync_scheduled_ = false;
+
+        if (PQpipelineSync(c_) != 1) {
+          fail_pending();
+          return;
+        }
+
+        pending_.push(allocate_operation<pipeline_sync_operation>(
+              recycling_allocator<void>{recycler()}));
+        on_write_ready({});
+      });
+}
+
+void basic_connection::wait_read_ready() {
+  socket_.async_wait(socket_t::wait_read,
+      [this](const auto& ec) {
+        // The wait is aborted when the socket is released by the destructor,
+        // so the connection may be gone.
+        if (ec == boost::asio::error::operation_aborted)
+          return;
+
+        on_read_ready(ec);
+      });
+}
+
+void basic_connection::wait_write_ready() {
+  socket_.async_wait(socket_t::wait_write,
+      [this](const auto& ec) {
+        if (ec == boost::asio::error::operation_aborted)
+          return;
+
+        writing_ = false;
+        on_write_ready(ec);
+      });
+}
+
+void basic_connection::on_read_ready(const boost::system::error_code& ec) {
+  if (ec || PQconsumeInput(c_) != 1) {
+    fail_pending();
+    return;
+  }
+
+#ifdef POSTGRESPP_TRACING
+  if (!pending_.empty())
+    trace_received(pending_.front());
+#endif
+
+  while (!pending_.empty()) {
+    if (PQisBusy(c_)) {
+      deliver_notifications();
+      wait_read_ready();
+      return;
+    }
+
+    const auto raw = PQgetResult(c_);
+    result res{raw};
+
+    if (res.done()) {
+      if (pending_.front().on_query_done())
+        continue;
+
+      auto op = pending_.pop();
+
+#ifdef POSTGRESPP_TRACING
+      trace_done(*op);
+#endif
+
+      if (op.get() == transient_last_) {
+        transient_last_ = nullptr;
+        transient_done_ = std::move(op);
+      } else {
+        // Before the handler, which may send queries that must come after.
+        if (rollback_scheduled_ && pending_.empty())
+          send_rollback();
+
+        dispatch(*op);
+      }
+    } else if (res.status() == result::status_t::PIPELINE_SYNC) {
+      pending_.pop();
+
+      if (transient_pipeline_) {
+        transient_pipeline_ = false;
+
+        if (!try_exit_pipeline_mode()) {
+          fail_pending();
+          return;
+        }
+
+        if (rollback_scheduled_ && pending_.empty())
+          send_rollback();
+
+        if (const auto op = std::move(transient_done_))
+          dispatch(*op);
+      }
+    } else if (res.copying()) {
+      // No further results arrive until the copy is ended, the operation is
+      // done with this one. The copy is driven by its own socket operations.
+      const auto op = pending_.pop();
+      reading_ = false;
+
+#ifdef POSTGRESPP_TRACING
+      trace_done(*op);
+#endif
+
+      op->on_result(std::move(res));
+      dispatch(*op);
+      return;
+    } else {
+#ifdef POSTGRESPP_TRACING
+      trace_result(pending_.front(), raw);
+#endif
+
+      receiving_ = pending_.front_id();
+      pending_.front().on_result(std::move(res));
+    }
+  }
+
+  if (exit_pipeline_scheduled_ && !try_exit_pipeline_mode()) {
+    fail_pending();
+    return;
+  }
+
+  deliver_notifications();
+
+  // The handlers may have sent queries or started waiting again.
+  if (!pending_.empty() || notification_waiter_) {
+    wait_read_ready();
+  } else {
+    reading_ = false;
+  }
+}
+
+void basic_connection::send_begin(const char* query) {
+  const auto transient = !pipeline_mode();
+
+  if (transient)
+    begin_transient_pipeline();
+
+  if (PQsendQueryParams(c_, query, 0, nullptr, nullptr, nullptr, nullptr, 0) != 1) {
+    const std::string message{last_error_message()};
+
+    if (transient)
+      abort_transient_pipeline();
+
+    throw std::runtime_error{"error executing query '" + std::string{query} + "': " + message};
+  }
+
+  enqueue(allocate_operation<discard_operation>(recycling_allocator<void>{recycler()}));
+
+  if (transient) {
+    boost::asio::post(socket_.get_executor(), [this] {
+          // Already done if the connection broke in the meantime.
+          if (!transient_open_)
+            return;
+
+          try {
+            sync_transient_pipeline();
+          } catch (...) {
+            fail_pending();
+          }
+        });
+  }
+}
+
+void basic_connection::abandon_transaction() noexcept {
+  if (busy() && !pipeline_mode())
+    rollback_scheduled_ = true;
+  else
+    send_rollback();
+}
+
+void basic_connection::send_rollback() noexcept {
+  rollback_scheduled_ = false;
+
+  try {
+    // Outside of pipeline mode, it is sent in a pipeline of its own so that
+    // the queries sent after it do not have to wait for its result.
+    const auto transient = !pipeline_mode();
+
+    if (transient)
+      begin_transient_pipeline();
+
+    if (PQsendQueryParams(c_, "ROLLBACK", 0, nullptr, nullptr, nullptr, nullptr, 0) != 1)
+      throw std::runtime_error{"could not send rollback"};
+
+    auto op = allocate_operation<discard_operation>(recycling_allocator<void>{recycler()});
+
+    if (transient)
+      end_transient_pipeline(std::move(op));
+    else
+      enqueue(std::move(op));
+  } catch (...) {
+    // The connection is broken, so the server rolls back anyway.
+    fail_pending();
+  }
+}
+
+void basic_connection::dispatch(pending_operation& op) {
+#ifdef POSTGRESPP_TRACING
+  const auto t = tracer_;
+  auto& trace = op.trace;
+
+  if (t && trace.traced) {
+    trace.dispatched = tracing::clock::now();
+
+    // The results arrived together with those of queries before it.
+    if (trace.first_byte == tracing::clock::time_point{})
+      trace.first_byte = trace.result_ready;
+
+    op.on_done();
+
+    trace.completed = tracing::clock::now();
+    t->on_complete(trace);
+
+    return;
+  }
+#endif
+
+  op.on_done();
+}
+
+void basic_connection::deliver_notifications() {
+  if (!notification_waiter_)
+    return;
+
+  std::vector<notification> notifications;
+
+  while (const auto n = PQnotifies(c_)) {
+    notifications.push_back({n->relname, n->extra, n->be_pid});
+    PQfreemem(n);
+  }
+
+  if (notifications.empty())
+    return;
+
+  const auto waiter = std::move(notification_waiter_);
+  waiter->complete({}, std::move(notifications));
+}
+
+void basic_connection::cancel_wait_notification() {
+  const auto waiter = std::move(notification_waiter_);
+
+  if (!waiter)
+    return;
+
+  // Nothing else is read while the connection is idle.
+  if (pending_.empty() && reading_ && !writing_) {
+    reading_ = false;
+    socket_.cancel();
+  }
+
+  waiter->complete(boost::asio::error::operation_aborted, {});
+}
+
+void basic_connection::poll_notifications() {
+  deliver_notifications();
+
+  if (notification_waiter_ && !reading_) {
+    reading_ = true;
+    wait_read_ready();
+  }
+}
+
+void basic_connection::on_write_ready(const boost::system::error_code& ec) {
+  if (ec) {
+    fail_pending();
+    return;
+  }
+
+  if (writing_)
+    return;
+
+  const auto ret = PQflush(c_);
+  if (ret == 1) {
+    writing_ = true;
+    wait_write_ready();
+  } else if (ret != 0) {
+    fail_pending();
+  }
+}
+
+void basic_connection::fail_pending() {
+  // Completing an operation may enqueue another one, which fails on its own
+  // as the connection is broken.
+  operation_queue failed{std::move(pending_)};
+
+  reading_ = false;
+  sync_scheduled_ = false;
+  transient_pipeline_ = false;
+  transient_open_ = false;
+  transient_last_ = nullptr;
+
+  // The server rolls back the transaction of a lost connection.
+  rollback_scheduled_ = false;
+
+  if (const auto op = std::move(transient_done_))
+    op->on_done();
+
+  if (const auto waiter = std::move(notification_waiter_))
+    waiter->complete(error::connection_broken, {});
+
+  while (!failed.empty()) {
+    const auto op = failed.pop();
+
+    op->on_error(result{PQmakeEmptyPGresult(c_, PGRES_FATAL_ERROR)});
+    op->on_done();
+  }
+}
+
 }
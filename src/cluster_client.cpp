@@ -0,0 +1,32 @@
+#include <cluster_client.hpp>
+
+namespace postgrespp {
+
+cluster_client::cluster_client(const executor_type& exc, std::string primary_conninfo,
+    const std::vector<std::string>& replica_conninfos, options opts)
+  : primary_{std::make_unique<pool_t>(exc, std::move(primary_conninfo), opts.primary)} {
+  replicas_.reserve(replica_conninfos.size());
+
+  for (const auto& conninfo : replica_conninfos)
+    replicas_.push_back(std::make_unique<pool_t>(exc, conninfo, opts.replica));
+}
+
+auto cluster_client::replica_for_read() -> pool_t& {
+  if (replicas_.empty())
+    return primary();
+
+  const auto start = next_replica_.fetch_add(1, std::memory_order_relaxed);
+
+  pool_t* best = nullptr;
+
+  for (std::size_t i = 0; i < replicas_.size(); ++i) {
+    auto& replica = *replicas_[(start + i) % replicas_.size()];
+
+    if (!best || replica.lent() < best->lent())
+      best = &replica;
+  }
+
+  return *best;
+}
+
+}
@@ -0,0 +1,146 @@
+#include <connection_pool.hpp>
+
+#include <async_connect.hpp>
+
+#include <algorithm>
+
+namespace postgrespp {
+
+pooled_connection::pooled_connection(connection_pool& pool, std::unique_ptr<connection_t> c)
+  : pool_{&pool}
+  , c_{std::move(c)} {
+  pool_->lent_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void pooled_connection::release() {
+  if (c_) {
+    pool_->lent_.fetch_sub(1, std::memory_order_relaxed);
+    pool_->release(std::move(c_));
+  }
+}
+
+connection_pool::connection_pool(const executor_type& exc, std::string pgconninfo, options opts)
+  : exc_{exc}
+  , strand_{boost::asio::make_strand(exc)}
+  , pgconninfo_{std::move(pgconninfo)}
+  , opts_{opts} {
+  for (std::size_t i = 0; i < opts_.min_size; ++i) {
+    ++size_;
+
+    async_connect(exc_, pgconninfo_.c_str(), [this](const auto& ec, connection_t c) {
+          if (ec) {
+            boost::asio::post(strand_, [this] { on_open_failed(); });
+          } else {
+            release(std::make_unique<connection_t>(std::move(c)));
+          }
+        });
+  }
+}
+
+void connection_pool::acquire(acquire_operation_ptr op) {
+  boost::asio::post(strand_, [this, op = std::move(op)]() mutable {
+        do_acquire(std::move(op));
+      });
+}
+
+void connection_pool::release(std::unique_ptr<connection_t> c) {
+  boost::asio::post(strand_, [this, c = std::move(c)]() mutable {
+        do_release(std::move(c));
+      });
+}
+
+void connection_pool::do_acquire(acquire_operation_ptr op) {
+  const auto it = std::find_if(idle_.begin(), idle_.end(),
+      [&](const auto& c) { return c->get_executor() == op->get_executor(); });
+
+  if (it != idle_.end()) {
+    auto c = std::move(*it);
+    idle_.erase(it);
+    op->complete({}, pooled_connection{*this, std::move(c)});
+  } else if (size_ < opts_.max_size) {
+    ++size_;
+    open(std::move(op));
+  } else if (!idle_.empty()) {
+    // An idle connection is bound to another executor; replace it with one
+    // bound to the executor of this operation.
+    close(std::move(idle_.back()));
+    idle_.pop_back();
+    open(std::move(op));
+  } else if (waiting_.size() >= opts_.max_waiting) {
+    op->complete(error::too_many_waiters, {});
+  } else {
+    waiting_.push_back(std::move(op));
+  }
+}
+
+void connection_pool::do_release(std::unique_ptr<connection_t> c) {
+  if (!reusable(*c)) {
+    close(std::move(c));
+
+    if (waiting_.empty()) {
+      --size_;
+    } else {
+      auto op = std::move(waiting_.front());
+      waiting_.pop_front();
+      open(std::move(op));
+    }
+
+    return;
+  }
+
+  const auto it = std::find_if(waiting_.begin(), waiting_.end(),
+      [&](const auto& op) { return op->get_executor() == c->get_executor(); });
+
+  if (it != waiting_.end()) {
+    auto op = std::move(*it);
+    waiting_.erase(it);
+    op->complete({}, pooled_connection{*this, std::move(c)});
+  } else if (!waiting_.empty()) {
+    auto op = std::move(waiting_.front());
+    waiting_.pop_front();
+    close(std::move(c));
+    open(std::move(op));
+  } else {
+    idle_.push_back(std::move(c));
+  }
+}
+
+void connection_pool::open(acquire_operation_ptr op) {
+  auto exc = op->get_executor();
+
+  async_connect(exc, pgconninfo_.c_str(),
+      [this, op = std::move(op)](const auto& ec, connection_t c) mutable {
+        if (ec) {
+          boost::asio::post(strand_, [this] { on_open_failed(); });
+          op->complete(ec, {});
+        } else {
+          op->complete({}, pooled_connection{*this, std::make_unique<connection_t>(std::move(c))});
+        }
+      });
+}
+
+void connection_pool::on_open_failed() {
+  --size_;
+
+  if (!waiting_.empty() && size_ < opts_.max_size) {
+    auto op = std::move(waiting_.front());
+    waiting_.pop_front();
+    do_acquire(std::move(op));
+  }
+}
+
+void connection_pool::close(std::unique_ptr<connection_t> c) {
+  const auto exc = c->get_executor();
+
+  boost::asio::post(exc, [c = std::move(c)] {});
+}
+
+bool connection_pool::reusable(connection_t& c) const {
+  const auto handle = c.underlying_handle();
+
+  return PQstatus(handle) == CONNECTION_OK &&
+    PQtransactionStatus(handle) == PQTRANS_IDLE &&
+    !c.pipeline_mode();
+}
+
+}
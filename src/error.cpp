@@ -0,0 +1,79 @@
+#include <error.hpp>
+#include <sqlstate.hpp>
+
+#include <string>
+
+namespace postgrespp { namespace error {
+
+namespace {
+
+class category : public boost::system::error_category {
+public:
+  const char* name() const noexcept override {
+    return "postgrespp";
+  }
+
+  std::string message(int value) const override {
+    switch (static_cast<basic_errors>(value)) {
+      case connection_failed:
+        return "could not connect";
+      case too_many_waiters:
+        return "too many operations waiting for a connection";
+      case copy_failed:
+        return "copy failed";
+      case cancel_failed:
+        return "could not cancel";
+      case connection_broken:
+        return "connection broken";
+      case pipeline_aborted:
+        return "pipeline aborted";
+      case unexpected_result:
+        return "unexpected result";
+      case timed_out:
+        return "timed out";
+    }
+
+    return "unknown error";
+  }
+};
+
+}
+
+const boost::system::error_category& get_category() {
+  static const category instance;
+  return instance;
+}
+
+}}
+
+namespace postgrespp { namespace sqlstate {
+
+namespace {
+
+class category : public boost::system::error_category {
+public:
+  const char* name() const noexcept override {
+    return "postgrespp.sqlstate";
+  }
+
+  std::string message(int value) const override {
+    std::string code(5, '0');
+
+    for (auto it = code.rbegin(); it != code.rend(); ++it, value /= 36) {
+      const auto digit = value % 36;
+      *it = static_cast<char>(digit < 10 ? '0' + digit : 'A' + digit - 10);
+    }
+
+    return "SQLSTATE " + code;
+  }
+};
+
+}
+
+const boost::system::error_category& get_category() {
+  static const category instance;
+  return instance;
+}
+
+}}
+
@@ -0,0 +1,43 @@
+#include <io_context_pool.hpp>
+
+#include <algorithm>
+
+namespace postgrespp {
+
+io_context_pool::io_context_pool(std::size_t size)
+  : contexts_(std::max<std::size_t>(size, 1)) {
+  threads_.reserve(contexts_.size());
+
+  for (auto& c : contexts_)
+    threads_.emplace_back([&ioc = c.ioc] { ioc.run(); });
+}
+
+io_context_pool::~io_context_pool() {
+  stop();
+  join();
+}
+
+auto io_context_pool::get_executor() -> executor_type {
+  const auto i = next_.fetch_add(1, std::memory_order_relaxed) % contexts_.size();
+
+  return contexts_[i].ioc.get_executor();
+}
+
+void io_context_pool::release() {
+  for (auto& c : contexts_)
+    c.work.reset();
+}
+
+void io_context_pool::stop() {
+  for (auto& c : contexts_)
+    c.ioc.stop();
+}
+
+void io_context_pool::join() {
+  for (auto& t : threads_) {
+    if (t.joinable())
+      t.join();
+  }
+}
+
+}
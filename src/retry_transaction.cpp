@@ -0,0 +1,27 @@
+#include <retry_transaction.hpp>
+
+#include <algorithm>
+#include <random>
+
+namespace postgrespp {
+
+std::chrono::nanoseconds retry_policy::backoff(std::size_t retry) const {
+  thread_local std::minstd_rand engine{std::random_device{}()};
+
+  const std::chrono::nanoseconds max = max_backoff;
+  std::chrono::nanoseconds bound = initial_backoff;
+
+  for (std::size_t i = 1; i < retry && bound < max; ++i)
+    bound *= 2;
+
+  bound = std::min(bound, max);
+
+  if (bound.count() <= 0)
+    return std::chrono::nanoseconds::zero();
+
+  std::uniform_int_distribution<std::chrono::nanoseconds::rep> distribution{0, bound.count()};
+
+  return std::chrono::nanoseconds{distribution(engine)};
+}
+
+}
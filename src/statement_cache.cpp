@@ -0,0 +1,75 @@
+#include <statement_cache.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+namespace postgrespp {
+
+bool statement_cache::key::operator==(const key& rhs) const {
+  return query == rhs.query &&
+    std::equal(types.oids, types.oids + types.size, rhs.types.oids, rhs.types.oids + rhs.types.size);
+}
+
+std::size_t statement_cache::key_hash::operator()(const key& k) const {
+  auto h = std::hash<std::string_view>{}(k.query);
+
+  for (int i = 0; i < k.types.size; ++i)
+    h = h * 31 + k.types.oids[i];
+
+  return h;
+}
+
+statement_cache::statement_cache(size_type capacity)
+  : capacity_{capacity} {
+}
+
+void statement_cache::set_capacity(size_type capacity) {
+  if (capacity < size())
+    throw std::runtime_error{"statement cache holds more statements than the new capacity"};
+
+  capacity_ = capacity;
+}
+
+const std::string* statement_cache::find(const char* query, param_types types) {
+  const auto it = index_.find(key{query, types});
+
+  if (it == index_.end())
+    return nullptr;
+
+  entries_.splice(entries_.begin(), entries_, it->second);
+
+  return &it->second->name;
+}
+
+const std::string& statement_cache::insert(const char* query, param_types types,
+    std::string& evicted) {
+  evicted.clear();
+
+  if (size() >= capacity_ && !entries_.empty()) {
+    auto& lru = entries_.back();
+
+    index_.erase(key_of(lru));
+    evicted = std::move(lru.name);
+    entries_.pop_back();
+  }
+
+  entries_.push_front({query, {types.oids, types.oids + types.size},
+      "postgrespp_" + std::to_string(next_id_++)});
+  index_.emplace(key_of(entries_.front()), entries_.begin());
+
+  return entries_.front().name;
+}
+
+void statement_cache::erase(const std::string& name) {
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->name == name) {
+      index_.erase(key_of(*it));
+      entries_.erase(it);
+      return;
+    }
+  }
+}
+
+}
@@ -0,0 +1,92 @@
+#include <tracing.hpp>
+
+#include <functional>
+
+namespace postgrespp { namespace tracing {
+
+statement_tracer::statement_tracer(std::size_t capacity)
+  : capacity_{capacity}
+  , slots_{new slot[capacity]} {
+}
+
+statement_tracer::~statement_tracer() {
+  for (std::size_t i = 0; i < capacity_; ++i)
+    delete slots_[i].stats.load(std::memory_order_relaxed);
+}
+
+std::uint64_t statement_tracer::hash_of(std::string_view query) {
+  const std::uint64_t hash = std::hash<std::string_view>{}(query);
+
+  // 0 marks an empty slot.
+  return hash == 0 ? 1 : hash;
+}
+
+std::uint32_t statement_tracer::on_send(std::string_view query) {
+  const auto hash = hash_of(query);
+
+  for (std::size_t n = 0, i = hash % capacity_; n < capacity_; ++n, i = (i + 1) % capacity_) {
+    auto& s = slots_[i];
+    auto slot_hash = s.hash.load(std::memory_order_acquire);
+
+    if (slot_hash == 0) {
+      if (s.hash.compare_exchange_strong(slot_hash, hash, std::memory_order_acq_rel)) {
+        s.query = query;
+        s.stats.store(new statistics, std::memory_order_release);
+
+        return static_cast<std::uint32_t>(i);
+      }
+    }
+
+    if (slot_hash == hash) {
+      const auto stats = s.stats.load(std::memory_order_acquire);
+
+      // Another thread is adding the statement; if it is another statement
+      // with the same hash, keep looking.
+      if (!stats || s.query == query)
+        return static_cast<std::uint32_t>(i);
+    }
+  }
+
+  return static_cast<std::uint32_t>(capacity_);
+}
+
+void statement_tracer::on_complete(const query_trace& trace) {
+  if (trace.statement >= capacity_)
+    return;
+
+  const auto stats = slots_[trace.statement].stats.load(std::memory_order_acquire);
+
+  if (!stats)
+    return;
+
+  stats->server.record(trace.first_byte - trace.sent);
+  stats->receive.record(trace.result_ready - trace.first_byte);
+  stats->handler.record(trace.completed - trace.dispatched);
+  stats->total.record(trace.completed - trace.sent);
+  stats->rows.fetch_add(trace.rows, std::memory_order_relaxed);
+  stats->bytes_sent.fetch_add(trace.bytes_sent, std::memory_order_relaxed);
+  stats->bytes_received.fetch_add(trace.bytes_received, std::memory_order_relaxed);
+}
+
+auto statement_tracer::find(std::string_view query) const -> const statistics* {
+  const auto hash = hash_of(query);
+
+  for (std::size_t n = 0, i = hash % capacity_; n < capacity_; ++n, i = (i + 1) % capacity_) {
+    const auto& s = slots_[i];
+    const auto slot_hash = s.hash.load(std::memory_order_acquire);
+
+    if (slot_hash == 0)
+      return nullptr;
+
+    if (slot_hash == hash) {
+      const auto stats = s.stats.load(std::memory_order_acquire);
+
+      if (stats && s.query == query)
+        return stats;
+    }
+  }
+
+  return nullptr;
+}
+
+}}
@@ -0,0 +1,87 @@
+#include "example_data_fixture.hpp"
+
+#include <async_exec.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+namespace {
+
+std::atomic<std::size_t> allocations{0};
+
+}
+
+void* operator new(std::size_t size) {
+  ++allocations;
+
+  if (const auto p = std::malloc(size))
+    return p;
+
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+using namespace postgrespp;
+
+class AllocationTest : public example_data_fixture {
+protected:
+  static constexpr std::size_t warmup_queries = 100;
+  static constexpr std::size_t measured_queries = 1000;
+
+  /// Sends the next query from the handler of the previous one.
+  struct query_loop {
+    AllocationTest* test;
+
+    void operator()(result&& res) const {
+      ASSERT_EQ(result::status_t::TUPLES_OK, res.status()) << res.error_message();
+      ASSERT_EQ(static_cast<std::int64_t>(test->num_queries_), res.at(0).at(0).as<std::int64_t>());
+
+      test->next();
+    }
+  };
+
+  void next() {
+    if (num_queries_ == warmup_queries)
+      allocations_before_ = allocations;
+
+    if (num_queries_ == warmup_queries + measured_queries) {
+      allocations_after_ = allocations;
+      return;
+    }
+
+    ++num_queries_;
+
+    async_exec(*c_, "SELECT $1::int8 WHERE $2::text IS NOT NULL", query_loop{this},
+        static_cast<std::int64_t>(num_queries_), text_);
+  }
+
+protected:
+  ioc_t ioc_;
+  std::optional<connection_t> c_ = std::make_optional<connection_t>(ioc_, CONN_STRING);
+  const std::string text_ = "a text parameter that is longer than the small string buffer";
+
+  std::size_t num_queries_ = 0;
+  std::size_t allocations_before_ = 0;
+  std::size_t allocations_after_ = 0;
+};
+
+TEST_F(AllocationTest, small_query_does_not_allocate) {
+  next();
+
+  ioc_.run();
+
+  ASSERT_EQ(warmup_queries + measured_queries, num_queries_);
+  ASSERT_EQ(0, allocations_after_ - allocations_before_);
+}
@@ -2,10 +2,20 @@
 
 #include <async_exec.hpp>
 #include <use_future.hpp>
+#include <with_error_code.hpp>
+#include <with_timeout.hpp>
 
 #include <gtest/gtest.h>
 
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <cstring>
 #include <functional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 class AsyncExec : public example_data_fixture {
 protected:
@@ -80,6 +90,25 @@ TEST_F(AsyncExec, insert_param) {
   ASSERT_EQ(1, num_calls_);
 }
 
+TEST_F(AsyncExec, insert_param_implicit_transaction) {
+  async_exec(connection(), "INSERT INTO " TEST_TABLE " (si, i, bi) VALUES ($1, $2, $3)", wrap_handler([this](auto&& result) {
+        ASSERT_EQ(result::status_t::COMMAND_OK, result.status()) << result.error_message();
+        ASSERT_EQ(PQTRANS_IDLE, PQtransactionStatus(connection().underlying_handle()));
+      }),
+      static_cast<std::int16_t>(1), 2, static_cast<std::int64_t>(3));
+
+  ioc_.run();
+
+  ASSERT_EQ(1, num_calls_);
+
+  pqxx::connection c{CONN_STRING};
+  pqxx::work txn{c};
+  const auto result = txn.exec("SELECT * FROM " TEST_TABLE " WHERE id > " TEST_TABLE_INITIAL_ROWS);
+
+  ASSERT_EQ(1, result.size());
+  txn.commit();
+}
+
 TEST_F(AsyncExec, transaction_select) {
   connection().async_transaction<>([this](auto txn) {
         auto s_txn = std::make_shared<work>(std::move(txn));
@@ -112,3 +141,274 @@ TEST_F(AsyncExec, transaction_select_param) {
 
   ASSERT_EQ(1, num_calls_);
 }
+
+TEST_F(AsyncExec, transaction_exec_batch) {
+  const std::vector<std::tuple<std::int16_t, std::string>> rows{{1, "a"}, {2, "b"}, {3, "c"}};
+
+  connection().async_transaction<>([&](auto txn) {
+        auto s_txn = std::make_shared<work>(std::move(txn));
+
+        s_txn->async_exec_batch("INSERT INTO " TEST_TABLE " (si, t) VALUES ($1, $2)", rows,
+            wrap_handler([&, s_txn](batch_result result) {
+              ASSERT_TRUE(result.ok()) << result.error().error_message();
+              ASSERT_EQ((std::vector<batch_result::size_type>{1, 1, 1}), result.affected_rows());
+
+              s_txn->async_exec("SELECT count(*) FROM " TEST_TABLE, wrap_handler([s_txn](auto&& result) {
+                    ASSERT_EQ(6, result.at(0).at(0).template as<std::int64_t>());
+                  }));
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
+
+TEST_F(AsyncExec, transaction_exec_batch_error) {
+  const std::vector<std::pair<std::int32_t, std::int32_t>> params{{1, 1}, {0, 2}, {1, 3}};
+
+  connection().async_transaction<>([&](auto txn) {
+        auto s_txn = std::make_shared<work>(std::move(txn));
+
+        s_txn->async_exec_batch("UPDATE " TEST_TABLE " SET i = 1 / $1 WHERE id = $2", params,
+            wrap_handler([s_txn](batch_result result) {
+              ASSERT_FALSE(result.ok());
+              ASSERT_EQ(1, result.error_index());
+              ASSERT_NE(nullptr, std::strstr(result.error().error_message(), "division by zero"));
+              ASSERT_EQ((std::vector<batch_result::size_type>{1, 0, 0}), result.affected_rows());
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(AsyncExec, statement_cache) {
+  connection().set_statement_cache_capacity(2);
+
+  std::size_t remaining = 3;
+  std::function<void()> next;
+
+  next = [&] {
+    async_exec(connection(), "SELECT * FROM " TEST_TABLE " WHERE id = $1", wrap_handler([&](auto&& result) {
+          ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+          ASSERT_EQ(1, result.size());
+          ASSERT_FALSE(connection().pipeline_mode());
+
+          if (--remaining > 0)
+            next();
+        }),
+        1);
+  };
+
+  next();
+  ioc_.run();
+  ioc_.restart();
+
+  ASSERT_EQ(3, num_calls_);
+
+  async_exec(connection(), "SELECT name, statement FROM pg_prepared_statements ORDER BY name",
+      wrap_handler([](auto&& result) {
+        ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+        ASSERT_EQ(2, result.size());
+        ASSERT_STREQ("SELECT * FROM " TEST_TABLE " WHERE id = $1", result.at(0).at(1).template as<const char*>());
+      }));
+
+  run();
+
+  ASSERT_EQ(4, num_calls_);
+}
+
+TEST_F(AsyncExec, statement_cache_evicts_least_recently_used) {
+  connection().set_statement_cache_capacity(1);
+
+  async_exec(connection(), "SELECT 1", wrap_handler([&](auto&& result) {
+        ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+
+        async_exec(connection(), "SELECT name FROM pg_prepared_statements", wrap_handler([](auto&& result) {
+              ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+              ASSERT_EQ(1, result.size());
+              ASSERT_STREQ("postgrespp_1", result.at(0).at(0).template as<const char*>());
+            }));
+      }));
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
+
+TEST_F(AsyncExec, statement_cache_prepare_error) {
+  connection().set_statement_cache_capacity(1);
+
+  async_exec(connection(), "SELECT * FROM non_existent_table", wrap_handler([&](auto&& result) {
+        ASSERT_EQ(result::status_t::FATAL_ERROR, result.status());
+        ASSERT_NE(nullptr, std::strstr(result.error_message(), "non_existent_table"));
+
+        async_exec(connection(), "SELECT 1", wrap_handler([](auto&& result) {
+              ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+            }));
+      }));
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
+
+TEST_F(AsyncExec, static_query) {
+  static constexpr static_query<std::int64_t, std::string> query{
+    "SELECT id FROM " TEST_TABLE " WHERE bi = $1 AND t = $2"};
+
+  static_assert(decltype(query)::accepts<std::int64_t, const char*>());
+  static_assert(!decltype(query)::accepts<std::int32_t, const char*>());
+  static_assert(!decltype(query)::accepts<std::int64_t>());
+
+  async_exec(connection(), query, wrap_handler([](auto&& result) {
+        ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+        ASSERT_EQ(1, result.size());
+      }),
+      std::int64_t{40}, "row 0");
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(AsyncExec, static_query_statement_cache) {
+  static constexpr static_query<std::int16_t> query{"SELECT $1"};
+
+  connection().set_statement_cache_capacity(1);
+
+  async_exec(connection(), query, wrap_handler([&](auto&& result) {
+        ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+        ASSERT_EQ(7, result.at(0).at(0).template as<std::int16_t>());
+
+        async_exec(connection(), "SELECT parameter_types::text FROM pg_prepared_statements",
+            wrap_handler([](auto&& result) {
+              ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+              ASSERT_EQ(1, result.size());
+              ASSERT_STREQ("{smallint}", result.at(0).at(0).template as<const char*>());
+            }));
+      }),
+      std::int16_t{7});
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
+
+TEST_F(AsyncExec, statement_cache_keys_parameter_types) {
+  static constexpr static_query<std::int16_t> smallint_query{"SELECT $1"};
+  static constexpr static_query<std::int32_t> integer_query{"SELECT $1"};
+
+  connection().set_statement_cache_capacity(2);
+
+  async_exec(connection(), smallint_query, wrap_handler([&](auto&& result) {
+        ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+        ASSERT_EQ(7, result.at(0).at(0).template as<std::int16_t>());
+
+        // The same text with other types is prepared as another statement.
+        async_exec(connection(), integer_query, wrap_handler([](auto&& result) {
+              ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+              ASSERT_EQ(70000, result.at(0).at(0).template as<std::int32_t>());
+            }),
+            std::int32_t{70000});
+      }),
+      std::int16_t{7});
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
+
+TEST_F(AsyncExec, timeout_cancels_query) {
+  async_exec(connection(), "SELECT pg_sleep(10)",
+      with_timeout(connection(), std::chrono::milliseconds{100}, wrap_handler([&](auto&& result) {
+          ASSERT_EQ(result::status_t::FATAL_ERROR, result.status());
+          ASSERT_NE(nullptr, std::strstr(result.error_message(), "canceling statement"));
+
+          async_exec(connection(), "SELECT 1", wrap_handler([](auto&& result) {
+                ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+              }));
+        })));
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
+
+TEST_F(AsyncExec, timeout_not_reached) {
+  async_exec(connection(), "SELECT 1",
+      with_timeout(connection(), std::chrono::seconds{10}, wrap_handler([](auto&& result) {
+          ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+        })));
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(AsyncExec, cancel) {
+  async_exec(connection(), "SELECT pg_sleep(10)", wrap_handler([](auto&& result) {
+        ASSERT_EQ(result::status_t::FATAL_ERROR, result.status());
+      }));
+
+  // Once the server is running the query, as a cancel request sent before
+  // the query arrives does nothing.
+  boost::asio::steady_timer timer{connection().get_executor(), std::chrono::milliseconds{100}};
+  timer.async_wait([&](const auto&) {
+        connection().async_cancel(wrap_handler([](const auto& ec) {
+              ASSERT_FALSE(ec) << ec.message();
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
+
+TEST_F(AsyncExec, error_code) {
+  async_exec(connection(), "SELEC 1", with_error_code(wrap_handler([](const auto& ec, auto&& result) {
+          ASSERT_EQ(sqlstate::syntax_error, ec);
+          ASSERT_STREQ("42601", result.sqlstate());
+        })));
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(AsyncExec, broken_connection_completes_with_error) {
+  async_exec(connection(), "SELECT pg_terminate_backend(pg_backend_pid())",
+      with_error_code(wrap_handler([](const auto& ec, auto&& result) {
+          ASSERT_TRUE(ec);
+          ASSERT_FALSE(result.ok());
+        })));
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(AsyncExec, listen_notify) {
+  connection().async_listen("postgrespp test", wrap_handler([&](auto&& result) {
+        ASSERT_EQ(result::status_t::COMMAND_OK, result.status()) << result.error_message();
+
+        connection().async_wait_notification(wrap_handler([](const auto& ec, std::vector<notification> notifications) {
+              ASSERT_FALSE(ec) << ec.message();
+              ASSERT_EQ(2, notifications.size());
+              ASSERT_EQ("postgrespp test", notifications[0].channel);
+              ASSERT_EQ("a", notifications[0].payload);
+              ASSERT_EQ("b", notifications[1].payload);
+            }));
+
+        async_exec(connection(), "SELECT pg_notify('postgrespp test', 'a'), pg_notify('postgrespp test', 'b')",
+            wrap_handler([](auto&& result) {
+              ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+            }));
+      }));
+
+  run();
+
+  ASSERT_EQ(3, num_calls_);
+}
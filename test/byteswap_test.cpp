@@ -0,0 +1,50 @@
+#include <byteswap.hpp>
+
+#include <boost/endian/conversion.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+using namespace postgrespp;
+
+template <class T>
+class ByteswapTest : public ::testing::Test {
+};
+
+using byteswap_types = ::testing::Types<std::int16_t, std::uint32_t, std::int64_t>;
+TYPED_TEST_SUITE(ByteswapTest, byteswap_types);
+
+TYPED_TEST(ByteswapTest, reverse_inplace) {
+  // sizes around the vector width to cover the scalar tail
+  for (std::size_t n : {0, 1, 2, 3, 4, 7, 8, 9, 15, 16, 17, 100}) {
+    std::vector<TypeParam> values(n);
+
+    for (std::size_t i = 0; i < n; ++i)
+      values[i] = static_cast<TypeParam>(0x0102030405060708ull * (i + 1));
+
+    auto expected = values;
+    for (auto& v : expected)
+      boost::endian::endian_reverse_inplace(v);
+
+    byteswap::reverse_inplace<sizeof(TypeParam)>(values.data(), values.size());
+
+    ASSERT_EQ(expected, values) << "n = " << n;
+  }
+}
+
+TEST(ByteswapDoubleTest, big_to_native_inplace) {
+  std::vector<double> values{1.5, -2.25, 1e300, 0.0, 3.5};
+  const auto expected = values;
+
+  for (auto& v : values) {
+    using namespace boost::endian;
+
+    endian_store<double, sizeof(double), order::big>(reinterpret_cast<unsigned char*>(&v), double{v});
+  }
+
+  byteswap::big_to_native_inplace(values.data(), values.size());
+
+  ASSERT_EQ(expected, values);
+}
@@ -0,0 +1,86 @@
+#include "example_data_fixture.hpp"
+
+#include <async_exec.hpp>
+#include <cluster_client.hpp>
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <vector>
+
+using namespace postgrespp;
+
+class ClusterClientTest : public example_data_fixture {
+protected:
+  void run() {
+    ioc_.run();
+  }
+
+  template <class CallableT>
+  auto wrap_handler(CallableT&& callable) {
+    return [this, callable = std::move(callable)](auto&&... args) mutable {
+      ++num_calls_;
+      callable(std::forward<decltype(args)>(args)...);
+    };
+  }
+
+protected:
+  std::size_t num_calls_ = 0;
+  ioc_t ioc_;
+};
+
+TEST_F(ClusterClientTest, writes_go_to_primary) {
+  cluster_client client{ioc_, CONN_STRING, {CONN_STRING}};
+
+  client.async_acquire(wrap_handler([&](auto&& ec, pooled_connection c) {
+        ASSERT_FALSE(ec) << ec.message();
+        ASSERT_EQ(1, client.primary().lent());
+        ASSERT_EQ(0, client.replica(0).lent());
+      }));
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(ClusterClientTest, reads_are_spread_across_replicas) {
+  // Two connections per replica, so that none of the reads has to wait.
+  cluster_client client{ioc_, CONN_STRING, {CONN_STRING, CONN_STRING},
+    cluster_client::options{{}, {0, 2}}};
+
+  std::vector<pooled_connection> held;
+
+  for (int i = 0; i < 4; ++i) {
+    client.async_acquire<read_only>(wrap_handler([&](auto&& ec, pooled_connection c) {
+          ASSERT_FALSE(ec) << ec.message();
+          held.push_back(std::move(c));
+        }));
+  }
+
+  run();
+
+  ASSERT_EQ(4, num_calls_);
+  ASSERT_EQ(0, client.primary().lent());
+  ASSERT_EQ(2, client.replica(0).lent());
+  ASSERT_EQ(2, client.replica(1).lent());
+}
+
+TEST_F(ClusterClientTest, reads_go_to_primary_without_replicas) {
+  cluster_client client{ioc_, CONN_STRING, {}};
+
+  client.async_acquire<read_only>(wrap_handler([&](auto&& ec, pooled_connection c) {
+        ASSERT_FALSE(ec) << ec.message();
+        ASSERT_EQ(1, client.primary().lent());
+
+        auto& connection = *c;
+
+        async_exec(connection, "SELECT * FROM " TEST_TABLE,
+            wrap_handler([c = std::move(c)](auto&& result) {
+              ASSERT_EQ(result::status_t::TUPLES_OK, result.status());
+            }));
+      }));
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
@@ -0,0 +1,138 @@
+#include "example_data_fixture.hpp"
+
+#include <async_exec.hpp>
+#include <connection_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <optional>
+
+using namespace postgrespp;
+
+class ConnectionPoolTest : public example_data_fixture {
+protected:
+  using pool_t = connection_pool;
+
+  void run() {
+    ioc_.run();
+  }
+
+  template <class CallableT>
+  auto wrap_handler(CallableT&& callable) {
+    return [this, callable = std::move(callable)](auto&&... args) mutable {
+      ++num_calls_;
+      callable(std::forward<decltype(args)>(args)...);
+    };
+  }
+
+protected:
+  std::size_t num_calls_ = 0;
+  ioc_t ioc_;
+};
+
+TEST_F(ConnectionPoolTest, acquire_select) {
+  pool_t pool{ioc_, CONN_STRING};
+
+  pool.async_acquire([this](auto&& ec, auto c) {
+        ASSERT_FALSE(ec) << ec.message();
+        ASSERT_TRUE(c);
+
+        auto& connection = *c;
+
+        async_exec(connection, "SELECT * FROM " TEST_TABLE,
+            wrap_handler([c = std::move(c)](auto&& result) {
+              ASSERT_EQ(result::status_t::TUPLES_OK, result.status());
+              ASSERT_EQ(3, result.size());
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(ConnectionPoolTest, released_connection_is_reused) {
+  pool_t pool{ioc_, CONN_STRING, {1, 1}};
+
+  const connection_t* first = nullptr;
+
+  pool.async_acquire(wrap_handler([&](auto&& ec, auto c) {
+        ASSERT_FALSE(ec) << ec.message();
+        first = &*c;
+      }));
+
+  pool.async_acquire(wrap_handler([&](auto&& ec, auto c) {
+        ASSERT_FALSE(ec) << ec.message();
+        ASSERT_EQ(first, &*c);
+      }));
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
+
+TEST_F(ConnectionPoolTest, waits_for_release) {
+  pool_t pool{ioc_, CONN_STRING, {0, 1}};
+
+  std::optional<pooled_connection> held;
+
+  pool.async_acquire(wrap_handler([&](auto&& ec, auto c) {
+        ASSERT_FALSE(ec) << ec.message();
+        held = std::move(c);
+      }));
+
+  pool.async_acquire(wrap_handler([&](auto&& ec, auto c) {
+        ASSERT_FALSE(ec) << ec.message();
+        ASSERT_FALSE(held);
+      }));
+
+  pool.async_acquire(wrap_handler([&](auto&& ec, auto c) {
+        ASSERT_FALSE(ec) << ec.message();
+        ASSERT_FALSE(held);
+      }));
+
+  ioc_.poll();
+
+  ASSERT_EQ(1, num_calls_);
+  ASSERT_TRUE(held);
+
+  held.reset();
+
+  run();
+
+  ASSERT_EQ(3, num_calls_);
+}
+
+TEST_F(ConnectionPoolTest, too_many_waiters) {
+  pool_t pool{ioc_, CONN_STRING, {1, 1, 0}};
+
+  std::optional<pooled_connection> held;
+
+  pool.async_acquire(wrap_handler([&](auto&& ec, auto c) {
+        ASSERT_FALSE(ec) << ec.message();
+        held = std::move(c);
+      }));
+
+  pool.async_acquire(wrap_handler([&](auto&& ec, auto c) {
+        ASSERT_EQ(error::too_many_waiters, ec);
+        ASSERT_FALSE(c);
+        held.reset();
+      }));
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
+
+TEST_F(ConnectionPoolTest, connection_failed) {
+  pool_t pool{ioc_, "host=127.0.0.1 port=1 connect_timeout=1"};
+
+  pool.async_acquire(wrap_handler([&](auto&& ec, auto c) {
+        ASSERT_EQ(error::connection_failed, ec);
+        ASSERT_FALSE(c);
+      }));
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
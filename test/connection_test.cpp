@@ -1,5 +1,6 @@
 #include "example_data_fixture.hpp"
 
+#include <async_connect.hpp>
 #include <connection.hpp>
 #include <work.hpp>
 
@@ -9,6 +10,7 @@
 
 #include <cstdint>
 #include <optional>
+#include <vector>
 
 using namespace postgrespp;
 
@@ -26,6 +28,49 @@ TEST(ExternalIocConnectionTest, external_ioc_construct) {
   ioc.run();
 }
 
+TEST(AsyncConnectTest, async_connect) {
+  ioc_t ioc;
+
+  std::size_t called = 0;
+
+  async_connect(ioc, CONN_STRING, [&](const auto& ec, connection c) {
+        ++called;
+        ASSERT_FALSE(ec) << c.last_error_message();
+
+        auto shared_c = std::make_shared<connection>(std::move(c));
+
+        shared_c->async_transaction<>([&, shared_c](auto txn) {
+              auto shared_txn = std::make_shared<work>(std::move(txn));
+
+              shared_txn->async_exec("SELECT 1", [&, shared_c, shared_txn](auto&& result) {
+                    ++called;
+                    ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+                    shared_txn->commit([shared_c, shared_txn](auto&& res) { ASSERT_TRUE(res.ok()); });
+                  });
+            });
+      });
+
+  ioc.run();
+
+  ASSERT_EQ(2, called);
+}
+
+TEST(AsyncConnectTest, async_connect_failed) {
+  ioc_t ioc;
+
+  std::size_t called = 0;
+
+  async_connect(ioc, "host=127.0.0.1 port=1", [&](const auto& ec, connection c) {
+        ++called;
+        ASSERT_EQ(error::connection_failed, ec);
+        ASSERT_STRNE("", c.last_error_message());
+      });
+
+  ioc.run();
+
+  ASSERT_EQ(1, called);
+}
+
 class ConnectionTest : public example_data_fixture {
 protected:
   void run() {
@@ -318,6 +363,70 @@ TEST_F(ConnectionTest, async_exec_prepared_insert_10000) {
   txn.commit();
 }
 
+TEST_F(ConnectionTest, pipeline_select_param_in_order) {
+  constexpr std::size_t num_queries = 1000;
+
+  std::size_t called = 0;
+
+  connection().enter_pipeline_mode();
+
+  connection().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        for (std::size_t i = 0; i < num_queries; ++i) {
+          shared_txn->async_exec(
+              "SELECT $1::bigint",
+              [&, i, shared_txn](auto result) {
+                ASSERT_EQ(i, called++);
+                ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+                ASSERT_EQ(i, result.at(0).at(0).template as<std::int64_t>());
+
+                if (called == num_queries) {
+                  shared_txn->commit([&, shared_txn](auto&& res) {
+                        ASSERT_TRUE(res.ok());
+                        connection().exit_pipeline_mode();
+                      });
+                }
+              },
+              static_cast<std::int64_t>(i));
+        }
+      });
+
+  run();
+
+  ASSERT_EQ(num_queries, called);
+}
+
+TEST_F(ConnectionTest, pipeline_aborted_after_error) {
+  std::vector<result::status_t> statuses;
+
+  connection().enter_pipeline_mode();
+
+  connection().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        const auto handler = [&](auto result) { statuses.push_back(result.status()); };
+
+        shared_txn->async_exec("SELECT 1", handler);
+        shared_txn->async_exec("SELECT * FROM non_existent_table", handler);
+        shared_txn->async_exec("SELECT 1", [&, handler, shared_txn](auto result) mutable {
+              handler(std::move(result));
+
+              shared_txn->rollback([&, shared_txn](auto&& res) {
+                    ASSERT_TRUE(res.ok());
+                    connection().exit_pipeline_mode();
+                  });
+            });
+      });
+
+  run();
+
+  ASSERT_EQ(3, statuses.size());
+  ASSERT_EQ(result::status_t::TUPLES_OK, statuses[0]);
+  ASSERT_EQ(result::status_t::FATAL_ERROR, statuses[1]);
+  ASSERT_EQ(result::status_t::PIPELINE_ABORTED, statuses[2]);
+}
+
 TEST_F(ConnectionTest, transaction_dtor_with_no_action) {
   std::size_t insertions = 0;
 
@@ -455,3 +564,40 @@ TEST_F(LargeDataTest, select_100000_rows) {
   ASSERT_EQ(num_rows_, rows_seen);
   ASSERT_EQ(1, num_batches);
 }
+
+TEST_F(LargeDataTest, stream_100000_rows) {
+  ioc_t ioc;
+
+  std::size_t num_calls = 0;
+  std::size_t rows_seen = 0;
+
+  connection c{ioc, CONN_STRING};
+
+  c.async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_exec_stream(
+            "SELECT * FROM " TEST_TABLE " ORDER BY id",
+            100,
+            [&](auto chunk) {
+              ASSERT_TRUE(chunk.ok()) << chunk.error_message();
+              ASSERT_TRUE(chunk.partial());
+              ASSERT_LE(1, chunk.size());
+              ASSERT_GE(100, chunk.size());
+
+              for (std::size_t i = 0; i < chunk.size(); ++i) {
+                ASSERT_EQ(rows_seen++, chunk.at(i).at(3).template as<std::int64_t>());
+              }
+            },
+            [&, shared_txn](auto result) {
+              ++num_calls;
+              ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+              ASSERT_EQ(0, result.size());
+            });
+      });
+
+  ioc.run();
+
+  ASSERT_EQ(num_rows_, rows_seen);
+  ASSERT_EQ(1, num_calls);
+}
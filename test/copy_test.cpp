@@ -0,0 +1,292 @@
+#include "example_data_fixture.hpp"
+
+#include <connection.hpp>
+#include <work.hpp>
+
+#include <pqxx/pqxx>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+
+using namespace postgrespp;
+
+class CopyTest : public example_data_fixture {
+protected:
+  void run() {
+    ioc_.run();
+    c_.reset();
+  }
+
+  connection_t& connection() { return c_.value(); }
+
+  template <class CallableT>
+  auto wrap_handler(CallableT&& callable) {
+    return [this, callable = std::move(callable)](auto&&... args) mutable {
+      ++num_calls_;
+      callable(std::forward<decltype(args)>(args)...);
+    };
+  }
+
+protected:
+  std::size_t num_calls_ = 0;
+  ioc_t ioc_;
+  std::optional<connection_t> c_ = std::make_optional<connection_t>(ioc_, CONN_STRING);
+};
+
+TEST_F(CopyTest, copy_in_100000) {
+  constexpr std::size_t num_rows = 100000;
+
+  std::shared_ptr<work> shared_txn;
+  std::size_t rows_written = 0;
+
+  std::function<void(copy_in_writer&)> write;
+
+  write = [&](copy_in_writer& writer) {
+    for (; rows_written < num_rows && writer.buffered_size() < 64 * 1024; ++rows_written) {
+      const std::optional<std::int32_t> i = rows_written % 2 ? std::nullopt : std::make_optional(20);
+
+      writer.write_row(static_cast<std::int16_t>(10), i, static_cast<std::int64_t>(rows_written),
+          std::string{"row "} + std::to_string(rows_written), 1.5f, 3.5);
+    }
+
+    if (rows_written < num_rows) {
+      writer.async_flush([&](const auto& ec) {
+            ASSERT_FALSE(ec) << connection().last_error_message();
+            write(writer);
+          });
+    } else {
+      writer.async_finish(wrap_handler([&](auto&& result) {
+            ASSERT_EQ(result::status_t::COMMAND_OK, result.status()) << result.error_message();
+            ASSERT_EQ(num_rows, result.affected_rows());
+            shared_txn->commit([&](auto&& res) { ASSERT_TRUE(res.ok()); });
+          }));
+    }
+  };
+
+  std::optional<copy_in_writer> writer;
+
+  connection().async_transaction<>([&](auto txn) {
+        shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_copy_in(TEST_TABLE, {"si", "i", "bi", "t", "r", "d"},
+            [&](auto&& result, copy_in_writer w) {
+              ASSERT_EQ(result::status_t::COPY_IN, result.status()) << result.error_message();
+
+              writer.emplace(std::move(w));
+              write(*writer);
+            });
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+
+  pqxx::connection c{CONN_STRING};
+  pqxx::work txn{c};
+  const auto result = txn.exec("SELECT bi, i, t FROM " TEST_TABLE " WHERE id > " TEST_TABLE_INITIAL_ROWS " ORDER BY id");
+
+  ASSERT_EQ(num_rows, result.size());
+
+  for (std::size_t i = 0; i < result.size(); ++i) {
+    ASSERT_EQ(i, result[i][0].as<std::int64_t>());
+    ASSERT_EQ(i % 2 == 1, result[i][1].is_null());
+    ASSERT_EQ("row " + std::to_string(i), result[i][2].as<std::string>());
+  }
+  txn.commit();
+}
+
+TEST_F(CopyTest, copy_in_on_strand) {
+  const auto strand = boost::asio::make_strand(ioc_);
+
+  std::shared_ptr<work> shared_txn;
+  std::optional<copy_in_writer> writer;
+
+  connection().async_transaction<>([&](auto txn) {
+        shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_copy_in(TEST_TABLE, {"bi"}, [&](auto&& result, copy_in_writer w) {
+              ASSERT_EQ(result::status_t::COPY_IN, result.status()) << result.error_message();
+
+              writer.emplace(std::move(w));
+              writer->write_row(std::int64_t{1});
+
+              writer->async_flush(boost::asio::bind_executor(strand, wrap_handler([&](const auto& ec) {
+                    ASSERT_TRUE(strand.running_in_this_thread());
+                    ASSERT_FALSE(ec);
+
+                    writer->async_finish(boost::asio::bind_executor(strand, wrap_handler([&](auto&& result) {
+                          ASSERT_TRUE(strand.running_in_this_thread());
+                          ASSERT_EQ(1, result.affected_rows());
+                          shared_txn->commit([&](auto&& res) { ASSERT_TRUE(res.ok()); });
+                        })));
+                  })));
+            });
+      });
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
+
+TEST_F(CopyTest, copy_in_unknown_table) {
+  connection().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_copy_in("non_existent_table", {},
+            wrap_handler([shared_txn](auto&& result, copy_in_writer w) {
+              ASSERT_EQ(result::status_t::FATAL_ERROR, result.status());
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(CopyTest, copy_out) {
+  std::size_t num_rows = 0;
+
+  connection().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_copy_out("COPY (SELECT si, i, bi, t, r, d FROM " TEST_TABLE " ORDER BY id) TO STDOUT (FORMAT binary)",
+            [&](const binary_copy::row& row) {
+              ASSERT_EQ(6, row.size());
+
+              const auto [si, i, bi, t, r, d] = row.as<
+                std::optional<std::int16_t>, std::optional<std::int32_t>, std::optional<std::int64_t>,
+                std::optional<std::string>, std::optional<float>, std::optional<double>>();
+
+              if (num_rows == 0) {
+                ASSERT_EQ(10, si);
+                ASSERT_EQ(20, i);
+                ASSERT_EQ(40, bi);
+                ASSERT_EQ("row 0", t);
+                ASSERT_EQ(1.5f, r);
+                ASSERT_EQ(3.5, d);
+              } else if (num_rows == 2) {
+                ASSERT_FALSE(si);
+                ASSERT_FALSE(t);
+                ASSERT_FALSE(d);
+              }
+
+              ++num_rows;
+            },
+            wrap_handler([shared_txn](auto&& result) {
+              ASSERT_EQ(result::status_t::COMMAND_OK, result.status()) << result.error_message();
+              ASSERT_EQ(3, result.affected_rows());
+              shared_txn->commit([shared_txn](auto&& res) { ASSERT_TRUE(res.ok()); });
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+  ASSERT_EQ(3, num_rows);
+}
+
+TEST_F(CopyTest, copy_out_100000) {
+  constexpr std::size_t num_rows = 100000;
+
+  {
+    pqxx::connection c{CONN_STRING};
+    pqxx::work txn{c};
+    txn.exec("INSERT INTO " TEST_TABLE " (bi, t) SELECT n, 'row ' || n FROM generate_series(1, 100000) n");
+    txn.commit();
+  }
+
+  std::int64_t sum = 0;
+  std::size_t rows_read = 0;
+
+  connection().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_copy_out("COPY (SELECT bi, t FROM " TEST_TABLE " WHERE id > $1) TO STDOUT (FORMAT binary)",
+            [&](const binary_copy::row& row) {
+              auto it = row.begin();
+              const auto bi = (*it++).as<std::int64_t>();
+              ASSERT_EQ("row " + std::to_string(bi), (*it).as<std::string>());
+              sum += bi;
+              ++rows_read;
+            },
+            wrap_handler([shared_txn](auto&& result) {
+              ASSERT_EQ(result::status_t::COMMAND_OK, result.status()) << result.error_message();
+              shared_txn->commit([shared_txn](auto&& res) { ASSERT_TRUE(res.ok()); });
+            }),
+            3);
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+  ASSERT_EQ(num_rows, rows_read);
+  ASSERT_EQ(static_cast<std::int64_t>(num_rows * (num_rows + 1) / 2), sum);
+}
+
+TEST_F(CopyTest, copy_out_error) {
+  connection().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_copy_out("COPY non_existent_table TO STDOUT (FORMAT binary)",
+            [&](const binary_copy::row& row) {
+              FAIL();
+            },
+            wrap_handler([shared_txn](auto&& result) {
+              ASSERT_EQ(result::status_t::FATAL_ERROR, result.status());
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(CopyTest, copy_out_error_on_strand) {
+  const auto strand = boost::asio::make_strand(ioc_);
+
+  connection().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_copy_out("COPY non_existent_table TO STDOUT (FORMAT binary)",
+            [&](const binary_copy::row& row) {
+              FAIL();
+            },
+            boost::asio::bind_executor(strand, wrap_handler([strand, shared_txn](auto&& result) {
+              ASSERT_TRUE(strand.running_in_this_thread());
+              ASSERT_EQ(result::status_t::FATAL_ERROR, result.status());
+            })));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(CopyTest, copy_out_text_format) {
+  connection().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_copy_out("COPY (SELECT si FROM " TEST_TABLE ") TO STDOUT",
+            [&](const binary_copy::row& row) {
+              FAIL();
+            },
+            wrap_handler([this, shared_txn](auto&& result) {
+              ASSERT_EQ(error::unexpected_result, result.error_code());
+
+              shared_txn->commit(wrap_handler([shared_txn](auto&& result) {
+                    ASSERT_TRUE(result.ok());
+                  }));
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
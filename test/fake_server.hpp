@@ -0,0 +1,607 @@
+#pragma once
+
+#include <binary_copy.hpp>
+#include <pgoutput.hpp>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/endian/conversion.hpp>
+
+#include <libpq-fe.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace postgrespp { namespace testing {
+
+/**
+ * A stand-in for a server that speaks enough of the version 3 protocol for
+ * libpq to connect and run simple, extended and pipelined queries. It runs
+ * on its own thread and listens on a loopback port.
+ *
+ * Queries are answered from a script of \ref response by their exact text.
+ * BEGIN, COMMIT and ROLLBACK succeed unless scripted otherwise, and other
+ * queries fail with a syntax error. Cancel requests cancel queries that are
+ * waiting for their latency.
+ */
+class fake_server {
+public:
+  struct column {
+    std::string name;
+    Oid type;
+  };
+
+  using value_t = std::optional<std::string>;
+  using row_t = std::vector<value_t>;
+
+  struct response {
+    std::vector<column> columns;
+
+    /**
+     * Values are sent as they are, so they must be in binary format for
+     * queries sent with parameters and in text format for the others.
+     */
+    std::vector<row_t> rows;
+
+    /// Defaults to "SELECT <rows>".
+    std::string command_tag;
+
+    /// If set, the query fails with this SQLSTATE and \ref error_message.
+    std::string sqlstate;
+    std::string error_message;
+
+    /// How long to wait before answering.
+    std::chrono::microseconds latency{0};
+
+    /// Close the connection instead of answering.
+    bool drop = false;
+  };
+
+  struct options {
+    /**
+     * If not 0, data is sent to the client in writes of at most this many
+     * bytes, \ref write_delay apart.
+     */
+    std::size_t write_chunk_size = 0;
+    std::chrono::microseconds write_delay{0};
+  };
+
+public:
+  fake_server()
+    : fake_server{options{}} {
+  }
+
+  explicit fake_server(options opts)
+    : opts_{opts}
+    , acceptor_{ioc_, {boost::asio::ip::address_v4::loopback(), 0}} {
+    accept();
+    thread_ = std::thread{[this] { ioc_.run(); }};
+  }
+
+  fake_server(const fake_server&) = delete;
+  fake_server& operator=(const fake_server&) = delete;
+
+  ~fake_server() {
+    ioc_.stop();
+    thread_.join();
+  }
+
+  /// Answers \p query with \p res from now on.
+  void on(const std::string& query, response res) {
+    const std::lock_guard<std::mutex> lock{mutex_};
+
+    script_[query] = std::move(res);
+  }
+
+  /// Connection string to connect to the server.
+  std::string conn_string() const {
+    return "host=127.0.0.1 port=" + std::to_string(acceptor_.local_endpoint().port()) +
+      " user=postgres sslmode=disable gssencmode=disable";
+  }
+
+  /// Number of queries executed so far.
+  std::size_t num_queries() const { return num_queries_; }
+
+  /// A value of arithmetic type \p T in binary format.
+  template <class T>
+  static std::string binary(T value) {
+    std::string buf;
+    binary_copy::append_big_endian(buf, value);
+
+    return buf;
+  }
+
+private:
+  class session : public std::enable_shared_from_this<session> {
+  public:
+    session(fake_server& server, boost::asio::ip::tcp::socket&& socket)
+      : server_{server}
+      , socket_{std::move(socket)}
+      , timer_{socket_.get_executor()}
+      , write_timer_{socket_.get_executor()} {
+    }
+
+    void start() { read(); }
+
+  private:
+    struct portal {
+      std::string query;
+
+      /// The format of the results, the same for all columns.
+      std::int16_t format;
+    };
+
+    /// A message of the client, without its type and length.
+    struct message {
+      char type;
+      std::string body;
+    };
+
+    void read() {
+      socket_.async_read_some(boost::asio::buffer(read_buf_),
+          [this, self = shared_from_this()](const auto& ec, std::size_t n) {
+            if (ec || closed_)
+              return;
+
+            in_.append(read_buf_.data(), n);
+            process();
+            read();
+          });
+    }
+
+    /// Handles the messages read so far unless waiting to answer one.
+    void process() {
+      while (!closed_ && !timer_pending_) {
+        const auto msg = next_message();
+
+        if (!msg)
+          return;
+
+        handle(*msg);
+      }
+    }
+
+    std::optional<message> next_message() {
+      // The startup packet and the requests sent before it have no type.
+      const std::size_t header_size = started_ ? 5 : 4;
+
+      if (in_.size() < header_size)
+        return {};
+
+      const auto length = binary_copy::load_big_endian<std::int32_t>(in_.data() + header_size - 4);
+      const auto total = header_size - 4 + static_cast<std::size_t>(length);
+
+      if (in_.size() < total)
+        return {};
+
+      message msg{started_ ? in_[0] : '\0', in_.substr(header_size, total - header_size)};
+      in_.erase(0, total);
+
+      return msg;
+    }
+
+    void handle(const message& msg) {
+      pgoutput::message_reader r{msg.body.data(), msg.body.size()};
+
+      if (msg.type == '\0') {
+        handle_startup(r);
+        return;
+      }
+
+      // After an error in the extended protocol, everything up to Sync is
+      // skipped.
+      if (skipping_ && msg.type != 'S')
+        return;
+
+      switch (msg.type) {
+        case 'Q':
+          simple_query(std::string{r.read_string()});
+          break;
+        case 'P': {
+          const std::string name{r.read_string()};
+          statements_[name] = std::string{r.read_string()};
+          send('1', {});
+          break;
+        }
+        case 'B': {
+          const std::string portal{r.read_string()};
+          const std::string name{r.read_string()};
+
+          for (auto n = r.read<std::int16_t>(); n > 0; --n)
+            r.read<std::int16_t>();
+
+          for (auto n = r.read<std::int16_t>(); n > 0; --n) {
+            const auto length = r.read<std::int32_t>();
+            if (length > 0)
+              r.read_bytes(static_cast<std::size_t>(length));
+          }
+
+          const auto num_formats = r.read<std::int16_t>();
+          portals_[portal] = {statements_[name], num_formats > 0 ? r.read<std::int16_t>() : std::int16_t{0}};
+          send('2', {});
+          break;
+        }
+        case 'D': {
+          const auto kind = r.read_byte();
+          const std::string name{r.read_string()};
+
+          if (kind == 'S') {
+            const auto& query = statements_[name];
+
+            std::string body;
+            binary_copy::append_big_endian<std::int16_t>(body, num_params(query));
+            for (int i = 0; i < num_params(query); ++i)
+              binary_copy::append_big_endian<std::uint32_t>(body, 0);
+
+            send('t', body);
+            describe(lookup(query), 0);
+          } else {
+            const auto& p = portals_[name];
+            describe(lookup(p.query), p.format);
+          }
+          break;
+        }
+        case 'E': {
+          const std::string portal{r.read_string()};
+          execute(portals_[portal].query);
+          break;
+        }
+        case 'C':
+          send('3', {});
+          break;
+        case 'S':
+          skipping_ = false;
+          ready_for_query();
+          break;
+        case 'H':
+          break;
+        case 'X':
+        default:
+          close();
+          break;
+      }
+    }
+
+    void handle_startup(pgoutput::message_reader& r) {
+      const auto code = r.read<std::int32_t>();
+
+      // SSL and GSS encryption requests are declined.
+      if (code == 80877103 || code == 80877104) {
+        write("N");
+        return;
+      } else if (code == 80877102) {
+        const auto it = server_.sessions_.find(r.read<std::int32_t>());
+
+        if (it != server_.sessions_.end()) {
+          if (const auto target = it->second.lock())
+            target->cancel();
+        }
+
+        close();
+        return;
+      }
+
+      started_ = true;
+      pid_ = ++server_.last_pid_;
+      server_.sessions_[pid_] = weak_from_this();
+
+      std::string body;
+      binary_copy::append_big_endian<std::int32_t>(body, 0);
+      send('R', body);
+
+      parameter_status("server_version", "15.0");
+      parameter_status("server_encoding", "UTF8");
+      parameter_status("client_encoding", "UTF8");
+      parameter_status("DateStyle", "ISO, MDY");
+      parameter_status("integer_datetimes", "on");
+      parameter_status("standard_conforming_strings", "on");
+
+      body.clear();
+      binary_copy::append_big_endian<std::int32_t>(body, pid_);
+      binary_copy::append_big_endian<std::int32_t>(body, 0);
+      send('K', body);
+
+      ready_for_query();
+    }
+
+    void simple_query(const std::string& query) {
+      if (query.empty()) {
+        send('I', {});
+        ready_for_query();
+        return;
+      }
+
+      const auto res = lookup(query);
+
+      respond(res, [this](const response& res) {
+            if (res.sqlstate.empty() && !res.columns.empty())
+              describe(res, 0);
+
+            execute_response(res);
+            ready_for_query();
+          });
+    }
+
+    void execute(const std::string& query) {
+      const auto res = lookup(query);
+
+      respond(res, [this](const response& res) {
+            execute_response(res);
+
+            if (!res.sqlstate.empty())
+              skipping_ = true;
+          });
+    }
+
+    /**
+     * Applies the latency and faults of \p res before calling \p answer with
+     * it, or with an error if the query is canceled in the meantime.
+     */
+    void respond(const response& res, std::function<void(const response&)> answer) {
+      ++server_.num_queries_;
+
+      if (res.drop) {
+        close();
+      } else if (res.latency.count() == 0) {
+        answer(res);
+      } else {
+        timer_pending_ = true;
+        canceled_ = false;
+        timer_.expires_after(res.latency);
+        timer_.async_wait([this, self = shared_from_this(), res, answer = std::move(answer)](const auto&) {
+              timer_pending_ = false;
+
+              if (closed_)
+                return;
+
+              if (canceled_) {
+                response canceled;
+                canceled.sqlstate = "57014";
+                canceled.error_message = "canceling statement due to user request";
+
+                answer(canceled);
+              } else {
+                answer(res);
+              }
+
+              process();
+            });
+      }
+    }
+
+    /// Cancels the query waiting for its latency, if any.
+    void cancel() {
+      if (timer_pending_) {
+        canceled_ = true;
+        timer_.cancel();
+      }
+    }
+
+    void describe(const response& res, std::int16_t format) {
+      // Errors are only reported on execution.
+      if (res.columns.empty() || !res.sqlstate.empty()) {
+        send('n', {});
+        return;
+      }
+
+      std::string body;
+      binary_copy::append_big_endian<std::int16_t>(body, static_cast<std::int16_t>(res.columns.size()));
+
+      for (const auto& c : res.columns) {
+        body.append(c.name.c_str(), c.name.size() + 1);
+        binary_copy::append_big_endian<std::int32_t>(body, 0);
+        binary_copy::append_big_endian<std::int16_t>(body, 0);
+        binary_copy::append_big_endian<std::uint32_t>(body, c.type);
+        binary_copy::append_big_endian<std::int16_t>(body, -1);
+        binary_copy::append_big_endian<std::int32_t>(body, -1);
+        binary_copy::append_big_endian<std::int16_t>(body, format);
+      }
+
+      send('T', body);
+    }
+
+    void execute_response(const response& res) {
+      if (!res.sqlstate.empty()) {
+        std::string body;
+        field(body, 'S', "ERROR");
+        field(body, 'V', "ERROR");
+        field(body, 'C', res.sqlstate);
+        field(body, 'M', res.error_message);
+        body += '\0';
+        send('E', body);
+
+        if (transaction_status_ == 'T')
+          transaction_status_ = 'E';
+
+        return;
+      }
+
+      for (const auto& row : res.rows) {
+        std::string body;
+        binary_copy::append_big_endian<std::int16_t>(body, static_cast<std::int16_t>(row.size()));
+
+        for (const auto& value : row) {
+          if (value) {
+            binary_copy::append_big_endian<std::int32_t>(body, static_cast<std::int32_t>(value->size()));
+            body += *value;
+          } else {
+            binary_copy::append_big_endian<std::int32_t>(body, -1);
+          }
+        }
+
+        send('D', body);
+      }
+
+      const auto tag = res.command_tag.empty() ?
+        "SELECT " + std::to_string(res.rows.size()) : res.command_tag;
+
+      if (tag == "BEGIN")
+        transaction_status_ = 'T';
+      else if (tag == "COMMIT" || tag == "ROLLBACK")
+        transaction_status_ = 'I';
+
+      send('C', std::string{tag.c_str(), tag.size() + 1});
+    }
+
+    response lookup(const std::string& query) {
+      {
+        const std::lock_guard<std::mutex> lock{server_.mutex_};
+
+        const auto it = server_.script_.find(query);
+        if (it != server_.script_.end())
+          return it->second;
+      }
+
+      response res;
+
+      if (query == "BEGIN" || query == "COMMIT" || query == "ROLLBACK") {
+        res.command_tag = query;
+      } else {
+        res.sqlstate = "42601";
+        res.error_message = "unexpected query: " + query;
+      }
+
+      return res;
+    }
+
+    static std::int16_t num_params(const std::string& query) {
+      std::int16_t n = 0;
+
+      for (std::size_t pos = 0; (pos = query.find('$', pos)) != std::string::npos;)
+        n = std::max<std::int16_t>(n, static_cast<std::int16_t>(std::atoi(query.c_str() + ++pos)));
+
+      return n;
+    }
+
+    static void field(std::string& body, char type, const std::string& value) {
+      body += type;
+      body.append(value.c_str(), value.size() + 1);
+    }
+
+    void parameter_status(const std::string& name, const std::string& value) {
+      send('S', name + '\0' + value + '\0');
+    }
+
+    void ready_for_query() {
+      send('Z', std::string(1, transaction_status_));
+    }
+
+    void send(char type, const std::string& body) {
+      std::string msg(1, type);
+      binary_copy::append_big_endian<std::int32_t>(msg, static_cast<std::int32_t>(body.size() + 4));
+      msg += body;
+
+      write(msg);
+    }
+
+    void write(const std::string& data) {
+      out_ += data;
+      flush();
+    }
+
+    void flush() {
+      if (writing_ || out_.empty() || closed_)
+        return;
+
+      const auto chunk_size = server_.opts_.write_chunk_size;
+      const auto n = chunk_size == 0 ? out_.size() : std::min(chunk_size, out_.size());
+
+      writing_ = true;
+      writing_buf_ = out_.substr(0, n);
+      out_.erase(0, n);
+
+      boost::asio::async_write(socket_, boost::asio::buffer(writing_buf_),
+          [this, self = shared_from_this()](const auto& ec, std::size_t) {
+            if (ec) {
+              close();
+              return;
+            }
+
+            if (server_.opts_.write_delay.count() == 0) {
+              writing_ = false;
+              flush();
+            } else {
+              write_timer_.expires_after(server_.opts_.write_delay);
+              write_timer_.async_wait([this, self](const auto& ec) {
+                    writing_ = false;
+
+                    if (!ec)
+                      flush();
+                  });
+            }
+          });
+    }
+
+    void close() {
+      closed_ = true;
+      server_.sessions_.erase(pid_);
+
+      boost::system::error_code ec;
+      socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+      socket_.close(ec);
+      timer_.cancel();
+      write_timer_.cancel();
+    }
+
+  private:
+    fake_server& server_;
+    boost::asio::ip::tcp::socket socket_;
+    boost::asio::steady_timer timer_;
+    boost::asio::steady_timer write_timer_;
+    std::array<char, 8192> read_buf_;
+    std::string in_;
+    std::string out_;
+    std::string writing_buf_;
+    std::map<std::string, std::string> statements_;
+    std::map<std::string, portal> portals_;
+    char transaction_status_ = 'I';
+    bool started_ = false;
+    bool skipping_ = false;
+    std::int32_t pid_ = 0;
+    bool timer_pending_ = false;
+    bool canceled_ = false;
+    bool writing_ = false;
+    bool closed_ = false;
+  };
+
+  void accept() {
+    acceptor_.async_accept([this](const auto& ec, boost::asio::ip::tcp::socket socket) {
+          if (ec)
+            return;
+
+          // Answers are written message by message.
+          socket.set_option(boost::asio::ip::tcp::no_delay{true});
+
+          std::make_shared<session>(*this, std::move(socket))->start();
+          accept();
+        });
+  }
+
+private:
+  options opts_;
+  boost::asio::io_context ioc_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::map<std::string, response> script_;
+  std::atomic<std::size_t> num_queries_{0};
+
+  /// Sessions by process ID, to find them for cancel requests.
+  std::map<std::int32_t, std::weak_ptr<session>> sessions_;
+  std::int32_t last_pid_ = 0;
+};
+
+}}
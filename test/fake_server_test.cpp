@@ -0,0 +1,489 @@
+#include "fake_server.hpp"
+
+#include <async_exec.hpp>
+#include <connection.hpp>
+#include <sqlstate.hpp>
+#include <transaction_mode.hpp>
+#include <with_error_code.hpp>
+#include <with_timeout.hpp>
+#include <work.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/asio/post.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace postgrespp;
+using postgrespp::testing::fake_server;
+
+/// A parameter that fails to be encoded, after the query has been prepared.
+struct unencodable {};
+
+namespace postgrespp {
+
+template <>
+class type_encoder<unencodable, void> {
+public:
+  using encoder_t = type_encoder<unencodable>;
+  using value_t = const char*;
+
+public:
+  static std::size_t size(const unencodable&) { return 0; }
+
+  static constexpr int type(const unencodable&) { return 0; }
+
+  value_t to_text_value(const unencodable&) { throw std::runtime_error{"cannot encode"}; }
+};
+
+}
+
+class FakeServerTest : public ::testing::Test {
+protected:
+  void run() {
+    ioc_.run();
+    c_.reset();
+  }
+
+  connection& conn() {
+    if (!c_)
+      c_.emplace(ioc_, server_.conn_string().c_str());
+
+    return *c_;
+  }
+
+  template <class CallableT>
+  auto wrap_handler(CallableT&& callable) {
+    return [this, callable = std::move(callable)](auto&&... args) mutable {
+      ++num_calls_;
+      callable(std::forward<decltype(args)>(args)...);
+    };
+  }
+
+  static fake_server::response int4_rows(std::int32_t n) {
+    fake_server::response res;
+    res.columns = {{"i", 23}};
+
+    for (std::int32_t i = 0; i < n; ++i)
+      res.rows.push_back({fake_server::binary(i)});
+
+    return res;
+  }
+
+protected:
+  std::size_t num_calls_ = 0;
+  connection::io_context_t ioc_;
+  fake_server server_;
+  std::optional<connection> c_;
+};
+
+TEST_F(FakeServerTest, select) {
+  server_.on("SELECT i FROM t", int4_rows(100));
+
+  async_exec(conn(), "SELECT i FROM t", wrap_handler([](auto&& result) {
+        ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+        ASSERT_EQ(100, result.size());
+        ASSERT_EQ(99, result.at(99).at(0).template as<std::int32_t>());
+      }));
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+  ASSERT_EQ(1, server_.num_queries());
+}
+
+TEST_F(FakeServerTest, select_param_in_transaction) {
+  server_.on("SELECT i FROM t WHERE i < $1", int4_rows(3));
+
+  conn().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_exec("SELECT i FROM t WHERE i < $1", wrap_handler([shared_txn](auto&& result) {
+              ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+              ASSERT_EQ(3, result.size());
+
+              shared_txn->commit([shared_txn](auto&& res) { ASSERT_TRUE(res.ok()); });
+            }), std::int32_t{3});
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(FakeServerTest, begin_pipelined_with_first_statement) {
+  fake_server::response begin;
+  begin.command_tag = "BEGIN";
+  begin.latency = std::chrono::milliseconds{20};
+  server_.on("BEGIN ISOLATION LEVEL SERIALIZABLE, READ ONLY", begin);
+  server_.on("SELECT i FROM t", int4_rows(1));
+
+  conn().async_transaction<read_only, serializable>([&](auto txn) {
+        static_assert(decltype(txn)::is_read_only);
+
+        // Nothing has been sent yet.
+        ASSERT_EQ(0, server_.num_queries());
+
+        auto shared_txn = std::make_shared<decltype(txn)>(std::move(txn));
+
+        shared_txn->async_exec("SELECT i FROM t", wrap_handler([shared_txn](auto&& result) {
+              ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+
+              shared_txn->commit([shared_txn](auto&& res) { ASSERT_TRUE(res.ok()); });
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+  ASSERT_EQ(3, server_.num_queries());
+}
+
+TEST_F(FakeServerTest, failed_begin_aborts_first_statement) {
+  fake_server::response begin;
+  begin.sqlstate = "25001";
+  begin.error_message = "cannot use serializable mode in a hot standby";
+  server_.on("BEGIN ISOLATION LEVEL SERIALIZABLE", begin);
+  server_.on("SELECT i FROM t", int4_rows(1));
+
+  conn().async_transaction<void, serializable>([&](auto txn) {
+        txn.async_exec("SELECT i FROM t", wrap_handler([](auto&& result) {
+              ASSERT_EQ(result::status_t::PIPELINE_ABORTED, result.status());
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(FakeServerTest, failed_begin_aborts_batch) {
+  fake_server::response begin;
+  begin.sqlstate = "25001";
+  begin.error_message = "cannot use serializable mode in a hot standby";
+  server_.on("BEGIN ISOLATION LEVEL SERIALIZABLE", begin);
+
+  const std::vector<std::tuple<std::int32_t>> param_sets{{1}, {2}};
+
+  conn().async_transaction<void, serializable>([&](auto txn) {
+        txn.async_exec_batch("INSERT INTO t VALUES ($1)", param_sets, wrap_handler([](auto&& result) {
+              ASSERT_FALSE(result.ok());
+              ASSERT_EQ(batch_result::npos, result.error_index());
+              ASSERT_EQ(error::pipeline_aborted, result.error().error_code());
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(FakeServerTest, batch_parameter_not_encoded) {
+  fake_server::response insert;
+  insert.command_tag = "INSERT 0 1";
+  server_.on("INSERT INTO t VALUES ($1)", insert);
+
+  const std::vector<std::tuple<unencodable>> bad_param_sets{{}};
+  const std::vector<std::tuple<std::int32_t>> param_sets{{1}, {2}};
+
+  conn().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        ASSERT_THROW(shared_txn->async_exec_batch("INSERT INTO t VALUES ($1)", bad_param_sets,
+              wrap_handler([](auto&& result) {})), std::runtime_error);
+
+        // The results of the statement already prepared do not end up here.
+        shared_txn->async_exec_batch("INSERT INTO t VALUES ($1)", param_sets,
+            wrap_handler([shared_txn](auto&& result) {
+              ASSERT_TRUE(result.ok());
+              ASSERT_EQ(2, result.size());
+
+              shared_txn->commit([shared_txn](auto&& res) { ASSERT_TRUE(res.ok()); });
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(FakeServerTest, statement_cache_parameter_not_encoded) {
+  server_.on("SELECT i FROM t WHERE i < $1", int4_rows(3));
+
+  conn().set_statement_cache_capacity(1);
+
+  ASSERT_THROW(async_exec(conn(), "SELECT i FROM t WHERE i < $1", wrap_handler([](auto&& result) {}),
+        unencodable{}), std::runtime_error);
+
+  // The statement is prepared again and the connection stays usable.
+  async_exec(conn(), "SELECT i FROM t WHERE i < $1", wrap_handler([](auto&& result) {
+        ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+        ASSERT_EQ(3, result.size());
+      }), std::int32_t{3});
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(FakeServerTest, empty_transaction_sends_nothing) {
+  conn().async_transaction<>([&](auto txn) {
+        txn.commit(wrap_handler([](auto&& result) {
+              ASSERT_TRUE(result.ok());
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+  ASSERT_EQ(0, server_.num_queries());
+}
+
+TEST(TransactionModeTest, begin_statement) {
+  ASSERT_STREQ("BEGIN", (begin_statement<void, void>()));
+  ASSERT_STREQ("BEGIN READ ONLY", (begin_statement<read_only, void>()));
+  ASSERT_STREQ("BEGIN ISOLATION LEVEL REPEATABLE READ", (begin_statement<read_write, repeatable_read>()));
+  ASSERT_STREQ("BEGIN ISOLATION LEVEL SERIALIZABLE, READ ONLY, DEFERRABLE",
+      (begin_statement<deferrable, serializable>()));
+}
+
+TEST_F(FakeServerTest, abandoned_transaction_rolls_back) {
+  auto res = int4_rows(1);
+  res.latency = std::chrono::milliseconds{20};
+  server_.on("SELECT i FROM t", res);
+
+  conn().async_transaction<>([&](auto txn) {
+        // The transaction is destructed while its query is in progress.
+        txn.async_exec("SELECT i FROM t", wrap_handler([&](auto&& result) {
+              ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+
+              // Sent behind the ROLLBACK without waiting for it.
+              async_exec(conn(), "SELECT i FROM t", wrap_handler([](auto&& result) {
+                    ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+                  }));
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+  ASSERT_EQ(4, server_.num_queries());
+}
+
+TEST_F(FakeServerTest, error) {
+  fake_server::response res;
+  res.sqlstate = "40P01";
+  res.error_message = "deadlock detected";
+  server_.on("UPDATE t SET i = 1", res);
+
+  async_exec(conn(), "UPDATE t SET i = 1", with_error_code(wrap_handler([&](const auto& ec, auto&& result) {
+        ASSERT_EQ(sqlstate::deadlock_detected, ec);
+        ASSERT_STREQ("40P01", result.sqlstate());
+
+        // The connection is usable after the error.
+        async_exec(conn(), "BEGIN", wrap_handler([](auto&& result) {
+              ASSERT_EQ(result::status_t::COMMAND_OK, result.status()) << result.error_message();
+            }));
+      })));
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
+
+TEST_F(FakeServerTest, pipeline_aborted_after_error) {
+  fake_server::response res;
+  res.sqlstate = "23505";
+  res.error_message = "duplicate key";
+  server_.on("INSERT INTO t VALUES (1)", res);
+  server_.on("SELECT i FROM t", int4_rows(1));
+
+  conn().enter_pipeline_mode();
+
+  async_exec(conn(), "INSERT INTO t VALUES (1)", wrap_handler([](auto&& result) {
+        ASSERT_EQ(result::status_t::FATAL_ERROR, result.status());
+      }));
+  async_exec(conn(), "SELECT i FROM t", wrap_handler([&](auto&& result) {
+        ASSERT_EQ(result::status_t::PIPELINE_ABORTED, result.status());
+        conn().exit_pipeline_mode();
+      }));
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
+
+TEST_F(FakeServerTest, const_handler) {
+  server_.on("SELECT i FROM t", int4_rows(1));
+
+  std::vector<result::status_t> statuses;
+
+  conn().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        // The handler is copied for each query.
+        const auto handler = wrap_handler([&](auto&& result) { statuses.push_back(result.status()); });
+
+        shared_txn->async_exec("SELECT i FROM t", handler);
+        shared_txn->async_exec("SELECT i FROM t", handler);
+        shared_txn->commit([shared_txn](auto&& res) { ASSERT_TRUE(res.ok()); });
+      });
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+  ASSERT_EQ((std::vector<result::status_t>{result::status_t::TUPLES_OK, result::status_t::TUPLES_OK}), statuses);
+}
+
+TEST_F(FakeServerTest, latency) {
+  auto res = int4_rows(1);
+  res.latency = std::chrono::milliseconds{50};
+  server_.on("SELECT i FROM t", res);
+
+  const auto start = std::chrono::steady_clock::now();
+
+  async_exec(conn(), "SELECT i FROM t", wrap_handler([](auto&& result) {
+        ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+      }));
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+  ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds{50});
+}
+
+TEST_F(FakeServerTest, timeout_cancels_query) {
+  auto res = int4_rows(1);
+  res.latency = std::chrono::seconds{10};
+  server_.on("SELECT i FROM t", res);
+
+  async_exec(conn(), "SELECT i FROM t",
+      with_timeout(conn(), std::chrono::milliseconds{50}, with_error_code(wrap_handler(
+            [](const auto& ec, auto&& result) {
+              ASSERT_EQ(sqlstate::query_canceled, ec);
+            }))));
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(FakeServerTest, timeout_of_queued_query) {
+  auto slow = int4_rows(1);
+  slow.latency = std::chrono::milliseconds{200};
+  server_.on("SELECT i FROM slow", slow);
+  server_.on("SELECT i FROM t", int4_rows(1));
+
+  conn().enter_pipeline_mode();
+
+  const auto start = std::chrono::steady_clock::now();
+
+  // The query running is not the one timing out, so it is not cancelled.
+  async_exec(conn(), "SELECT i FROM slow", wrap_handler([&](auto&& result) {
+        ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+        conn().exit_pipeline_mode();
+      }));
+
+  // Completed without waiting for the query before it.
+  async_exec(conn(), "SELECT i FROM t",
+      with_timeout(conn(), std::chrono::milliseconds{50}, with_error_code(wrap_handler(
+            [&](const auto& ec, auto&& result) {
+              ASSERT_EQ(error::timed_out, ec);
+              ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds{200});
+            }))));
+
+  run();
+
+  ASSERT_EQ(2, num_calls_);
+}
+
+TEST_F(FakeServerTest, destruct_before_timeout) {
+  server_.on("SELECT i FROM t", int4_rows(1));
+
+  const auto start = std::chrono::steady_clock::now();
+
+  async_exec(conn(), "SELECT i FROM t",
+      with_timeout(conn(), std::chrono::seconds{10}, wrap_handler([](auto&& result) {})));
+
+  // The timer is stopped rather than left to reach the destroyed connection.
+  boost::asio::post(ioc_, [this] { c_.reset(); });
+
+  run();
+
+  ASSERT_EQ(0, num_calls_);
+  ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{5});
+}
+
+TEST_F(FakeServerTest, dropped_connection) {
+  fake_server::response res;
+  res.drop = true;
+  server_.on("SELECT i FROM t", res);
+
+  async_exec(conn(), "SELECT i FROM t", with_error_code(wrap_handler([](const auto& ec, auto&& result) {
+        ASSERT_EQ(error::connection_broken, ec);
+        ASSERT_FALSE(result.ok());
+      })));
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(FakeServerTest, cancel_wait_notification) {
+  conn().async_wait_notification(wrap_handler([](const auto& ec, std::vector<notification> notifications) {
+        ASSERT_EQ(boost::asio::error::operation_aborted, ec);
+        ASSERT_TRUE(notifications.empty());
+      }));
+
+  boost::asio::post(ioc_, [this] { conn().cancel_wait_notification(); });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(FakeServerTest, destruct_while_waiting_notification) {
+  conn().async_wait_notification(wrap_handler([](const auto& ec, std::vector<notification> notifications) {
+        ASSERT_EQ(boost::asio::error::operation_aborted, ec);
+      }));
+
+  // The wait reads from the socket once the wait has started.
+  boost::asio::post(ioc_, [this] { c_.reset(); });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST(FakeServerChunkedTest, partial_writes) {
+  fake_server server{{/* write_chunk_size */ 3, /* write_delay */ std::chrono::microseconds{100}}};
+
+  fake_server::response res;
+  res.columns = {{"t", 25}};
+  for (int i = 0; i < 20; ++i)
+    res.rows.push_back({std::string(100, 'a' + i % 26)});
+  server.on("SELECT t FROM t", res);
+
+  connection::io_context_t ioc;
+  connection c{ioc, server.conn_string().c_str()};
+
+  std::size_t called = 0;
+
+  async_exec(c, "SELECT t FROM t", [&](auto&& result) {
+        ++called;
+        ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+        ASSERT_EQ(20, result.size());
+        ASSERT_EQ(std::string(100, 't'), result.at(19).at(0).template as<std::string>());
+      });
+
+  ioc.run();
+
+  ASSERT_EQ(1, called);
+}
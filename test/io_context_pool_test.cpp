@@ -0,0 +1,74 @@
+#include "example_data_fixture.hpp"
+
+#include <async_exec.hpp>
+#include <io_context_pool.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using namespace postgrespp;
+
+class IoContextPoolTest : public example_data_fixture {
+protected:
+  template <class CallableT>
+  auto wrap_handler(CallableT&& callable) {
+    return [this, callable = std::move(callable)](auto&&... args) mutable {
+      ++num_calls_;
+      callable(std::forward<decltype(args)>(args)...);
+    };
+  }
+
+protected:
+  std::atomic<std::size_t> num_calls_{0};
+};
+
+TEST_F(IoContextPoolTest, connections_run_on_their_context) {
+  io_context_pool contexts{2};
+
+  std::vector<std::unique_ptr<connection_t>> connections;
+
+  for (std::size_t i = 0; i < 4; ++i) {
+    auto exc = contexts.get_executor();
+    connections.push_back(std::make_unique<connection_t>(exc, CONN_STRING));
+
+    async_exec(*connections.back(), "SELECT * FROM " TEST_TABLE, wrap_handler([exc](auto&& result) {
+          ASSERT_TRUE(exc.running_in_this_thread());
+          ASSERT_EQ(result::status_t::TUPLES_OK, result.status());
+          ASSERT_EQ(3, result.size());
+        }));
+  }
+
+  contexts.release();
+  contexts.join();
+
+  ASSERT_EQ(4, num_calls_);
+}
+
+TEST_F(IoContextPoolTest, handler_runs_on_associated_executor) {
+  io_context_pool contexts{2};
+
+  connection_t c{contexts.get_io_context(0), CONN_STRING};
+  auto strand = boost::asio::make_strand(contexts.get_io_context(1));
+
+  // The pool is released below, before the handler is dispatched to the strand.
+  auto work = boost::asio::make_work_guard(strand);
+
+  async_exec(c, "SELECT 1", boost::asio::bind_executor(strand, wrap_handler([&](auto&& result) {
+          work.reset();
+
+          ASSERT_TRUE(strand.running_in_this_thread());
+          ASSERT_EQ(result::status_t::TUPLES_OK, result.status());
+        })));
+
+  contexts.release();
+  contexts.join();
+
+  ASSERT_EQ(1, num_calls_);
+}
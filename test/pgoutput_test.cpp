@@ -0,0 +1,182 @@
+#include <binary_copy.hpp>
+#include <pgoutput.hpp>
+#include <replication_stream.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+using namespace postgrespp;
+
+namespace {
+
+void append_string(std::string& buf, const std::string& s) {
+  buf += s;
+  buf += '\0';
+}
+
+void append_text(std::string& buf, const std::string& value) {
+  buf += 't';
+  binary_copy::append_big_endian<std::int32_t>(buf, static_cast<std::int32_t>(value.size()));
+  buf += value;
+}
+
+pgoutput::message parse(const std::string& buf) {
+  return pgoutput::parse(buf.data(), buf.size());
+}
+
+}
+
+TEST(PgoutputTest, begin_commit) {
+  std::string buf = "B";
+  binary_copy::append_big_endian<std::uint64_t>(buf, 0x16B374D848);
+  binary_copy::append_big_endian<std::int64_t>(buf, 1000);
+  binary_copy::append_big_endian<std::uint32_t>(buf, 42);
+
+  const auto b = std::get<pgoutput::begin>(parse(buf));
+  ASSERT_EQ(0x16B374D848u, b.final_lsn);
+  ASSERT_EQ(1000, b.commit_time);
+  ASSERT_EQ(42u, b.xid);
+
+  buf = "C";
+  buf += '\0';
+  binary_copy::append_big_endian<std::uint64_t>(buf, 10);
+  binary_copy::append_big_endian<std::uint64_t>(buf, 20);
+  binary_copy::append_big_endian<std::int64_t>(buf, 30);
+
+  const auto c = std::get<pgoutput::commit>(parse(buf));
+  ASSERT_EQ(10u, c.commit_lsn);
+  ASSERT_EQ(20u, c.end_lsn);
+  ASSERT_EQ(30, c.commit_time);
+}
+
+TEST(PgoutputTest, relation) {
+  std::string buf = "R";
+  binary_copy::append_big_endian<std::uint32_t>(buf, 16384);
+  append_string(buf, "public");
+  append_string(buf, "users");
+  buf += 'd';
+  binary_copy::append_big_endian<std::int16_t>(buf, 2);
+  buf += '\1';
+  append_string(buf, "id");
+  binary_copy::append_big_endian<std::uint32_t>(buf, 23);
+  binary_copy::append_big_endian<std::int32_t>(buf, -1);
+  buf += '\0';
+  append_string(buf, "name");
+  binary_copy::append_big_endian<std::uint32_t>(buf, 25);
+  binary_copy::append_big_endian<std::int32_t>(buf, -1);
+
+  const auto r = std::get<pgoutput::relation>(parse(buf));
+  ASSERT_EQ(16384u, r.relation_id);
+  ASSERT_EQ("public", r.nspname);
+  ASSERT_EQ("users", r.relname);
+  ASSERT_EQ('d', r.replica_identity);
+  ASSERT_EQ(2u, r.columns.size());
+
+  auto it = r.columns.begin();
+  ASSERT_EQ("id", (*it).name);
+  ASSERT_EQ(1, (*it).flags);
+  ASSERT_EQ(23u, (*it).type);
+  ++it;
+  ASSERT_EQ("name", (*it).name);
+  ASSERT_EQ(25u, (*it).type);
+  ++it;
+  ASSERT_TRUE(it == r.columns.end());
+}
+
+TEST(PgoutputTest, update_with_old_key) {
+  std::string buf = "U";
+  binary_copy::append_big_endian<std::uint32_t>(buf, 16384);
+  buf += 'K';
+  binary_copy::append_big_endian<std::int16_t>(buf, 1);
+  append_text(buf, "1");
+  buf += 'N';
+  binary_copy::append_big_endian<std::int16_t>(buf, 3);
+  append_text(buf, "2");
+  buf += 'n';
+  buf += 'u';
+
+  const auto m = parse(buf);
+  const auto& u = std::get<pgoutput::update>(m);
+  ASSERT_EQ('K', u.old_kind);
+  ASSERT_EQ(1u, u.old_tuple.size());
+  ASSERT_EQ("1", (*u.old_tuple.begin()).data);
+
+  ASSERT_EQ(3u, u.new_tuple.size());
+  auto it = u.new_tuple.begin();
+  ASSERT_EQ(pgoutput::column_value::kind_t::text, (*it).kind);
+  ASSERT_EQ("2", (*it).data);
+  // The value points into the message, it is not copied.
+  ASSERT_GE((*it).data.data(), buf.data());
+  ASSERT_LT((*it).data.data(), buf.data() + buf.size());
+  ++it;
+  ASSERT_EQ(pgoutput::column_value::kind_t::null, (*it).kind);
+  ++it;
+  ASSERT_EQ(pgoutput::column_value::kind_t::unchanged, (*it).kind);
+  ++it;
+  ASSERT_TRUE(it == u.new_tuple.end());
+}
+
+TEST(PgoutputTest, insert_delete_truncate) {
+  std::string buf = "I";
+  binary_copy::append_big_endian<std::uint32_t>(buf, 1);
+  buf += 'N';
+  binary_copy::append_big_endian<std::int16_t>(buf, 1);
+  append_text(buf, "abc");
+
+  const auto i = std::get<pgoutput::insert>(parse(buf));
+  ASSERT_EQ(1u, i.relation_id);
+  ASSERT_EQ("abc", (*i.new_tuple.begin()).data);
+
+  buf = "D";
+  binary_copy::append_big_endian<std::uint32_t>(buf, 2);
+  buf += 'O';
+  binary_copy::append_big_endian<std::int16_t>(buf, 0);
+
+  const auto d = std::get<pgoutput::delete_>(parse(buf));
+  ASSERT_EQ(2u, d.relation_id);
+  ASSERT_EQ('O', d.old_kind);
+  ASSERT_EQ(0u, d.old_tuple.size());
+
+  buf = "T";
+  binary_copy::append_big_endian<std::int32_t>(buf, 2);
+  buf += '\1';
+  binary_copy::append_big_endian<std::uint32_t>(buf, 7);
+  binary_copy::append_big_endian<std::uint32_t>(buf, 8);
+
+  const auto t = std::get<pgoutput::truncate>(parse(buf));
+  ASSERT_EQ(1, t.options);
+  ASSERT_EQ(2u, t.size());
+  ASSERT_EQ(7u, t.relation_id(0));
+  ASSERT_EQ(8u, t.relation_id(1));
+}
+
+TEST(PgoutputTest, unknown) {
+  const std::string buf = "Mxyz";
+
+  const auto u = std::get<pgoutput::unknown>(parse(buf));
+  ASSERT_EQ('M', u.type);
+  ASSERT_EQ("xyz", u.data);
+}
+
+TEST(PgoutputTest, malformed) {
+  std::string buf = "I";
+  binary_copy::append_big_endian<std::uint32_t>(buf, 1);
+  buf += 'N';
+  binary_copy::append_big_endian<std::int16_t>(buf, 1);
+  buf += 't';
+  binary_copy::append_big_endian<std::int32_t>(buf, 10);
+  buf += "abc";
+
+  ASSERT_THROW(parse(buf), std::length_error);
+  ASSERT_THROW(parse("B"), std::length_error);
+  ASSERT_THROW(parse(std::string{"R\1\0\0\0public"}), std::length_error);
+}
+
+TEST(PgoutputTest, format_lsn) {
+  ASSERT_EQ("16/B374D848", format_lsn(0x16B374D848));
+  ASSERT_EQ("0/0", format_lsn(0));
+}
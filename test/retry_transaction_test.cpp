@@ -0,0 +1,131 @@
+#include "fake_server.hpp"
+
+#include <connection.hpp>
+#include <retry_transaction.hpp>
+#include <sqlstate.hpp>
+#include <transaction_mode.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/asio/use_awaitable.hpp>
+
+#include <chrono>
+#include <exception>
+#include <optional>
+
+using namespace postgrespp;
+using postgrespp::testing::fake_server;
+
+using boost::asio::awaitable;
+using boost::asio::use_awaitable;
+
+class RetryTransactionTest : public ::testing::Test {
+protected:
+  connection& conn() {
+    if (!c_)
+      c_.emplace(ioc_, server_.conn_string().c_str());
+
+    return *c_;
+  }
+
+  static fake_server::response failure(const char* sqlstate) {
+    fake_server::response res;
+    res.sqlstate = sqlstate;
+    res.error_message = "could not serialize access";
+
+    return res;
+  }
+
+  static fake_server::response update() {
+    fake_server::response res;
+    res.command_tag = "UPDATE 1";
+
+    return res;
+  }
+
+  /// Runs a transaction that updates t, failing until attempt \p succeed_at.
+  boost::system::error_code run(const char* sqlstate, std::size_t succeed_at) {
+    server_.on("BEGIN ISOLATION LEVEL SERIALIZABLE", [] {
+          fake_server::response res;
+          res.command_tag = "BEGIN";
+          return res;
+        }());
+    server_.on("UPDATE t SET i = 1", failure(sqlstate));
+
+    retry_policy policy;
+    policy.max_attempts = 3;
+    policy.initial_backoff = std::chrono::milliseconds{1};
+    policy.counters = &counters_;
+
+    std::optional<boost::system::error_code> result;
+
+    async_retry_transaction<read_write, serializable>(conn(),
+        [&](auto& txn) -> awaitable<boost::system::error_code> {
+          if (++attempts_ == succeed_at)
+            server_.on("UPDATE t SET i = 1", update());
+
+          const auto res = co_await txn.async_exec("UPDATE t SET i = 1", use_awaitable);
+          co_return res.error_code();
+        }, policy,
+        [&](std::exception_ptr e, boost::system::error_code ec) {
+          EXPECT_FALSE(e);
+          result = ec;
+        });
+
+    ioc_.run();
+    c_.reset();
+
+    EXPECT_TRUE(result);
+
+    return result.value_or(boost::system::error_code{});
+  }
+
+protected:
+  connection::io_context_t ioc_;
+  fake_server server_;
+  std::optional<connection> c_;
+  retry_counters counters_;
+  std::size_t attempts_ = 0;
+};
+
+TEST_F(RetryTransactionTest, retries_serialization_failure) {
+  ASSERT_FALSE(run("40001", 2));
+
+  ASSERT_EQ(2, attempts_);
+  ASSERT_EQ(1, counters_.transactions);
+  ASSERT_EQ(1, counters_.retries);
+  ASSERT_EQ(1, counters_.serialization_failures);
+  ASSERT_EQ(0, counters_.exhausted);
+
+  // BEGIN, UPDATE and ROLLBACK, then BEGIN, UPDATE and COMMIT.
+  ASSERT_EQ(6, server_.num_queries());
+}
+
+TEST_F(RetryTransactionTest, gives_up_after_max_attempts) {
+  ASSERT_EQ(sqlstate::deadlock_detected, run("40P01", 0));
+
+  ASSERT_EQ(3, attempts_);
+  ASSERT_EQ(2, counters_.retries);
+  ASSERT_EQ(3, counters_.deadlocks);
+  ASSERT_EQ(1, counters_.exhausted);
+}
+
+TEST_F(RetryTransactionTest, other_errors_are_not_retried) {
+  ASSERT_EQ(sqlstate::unique_violation, run("23505", 0));
+
+  ASSERT_EQ(1, attempts_);
+  ASSERT_EQ(0, counters_.retries);
+}
+
+TEST(RetryPolicyTest, backoff_is_bounded) {
+  retry_policy policy;
+  policy.initial_backoff = std::chrono::milliseconds{10};
+  policy.max_backoff = std::chrono::milliseconds{50};
+
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_LE(policy.backoff(1), std::chrono::milliseconds{10});
+    ASSERT_LE(policy.backoff(2), std::chrono::milliseconds{20});
+    ASSERT_LE(policy.backoff(10), std::chrono::milliseconds{50});
+    ASSERT_GE(policy.backoff(10), std::chrono::nanoseconds::zero());
+  }
+}
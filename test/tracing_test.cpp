@@ -0,0 +1,152 @@
+#include "fake_server.hpp"
+
+#include <async_exec.hpp>
+#include <connection.hpp>
+#include <latency_histogram.hpp>
+#include <tracing.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace postgrespp;
+using postgrespp::testing::fake_server;
+
+TEST(LatencyHistogramTest, buckets) {
+  for (std::uint64_t v : {0ull, 1ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull, (1ull << 39) + 12345}) {
+    const auto i = latency_histogram::index_of(v);
+
+    ASSERT_LT(i, latency_histogram::bucket_count);
+    ASSERT_GE(latency_histogram::upper_bound_of(i), v) << v;
+    // Values are kept within 1/16.
+    ASSERT_LE(latency_histogram::upper_bound_of(i) - v, v / 16) << v;
+  }
+
+  ASSERT_EQ(latency_histogram::bucket_count - 1, latency_histogram::index_of(~0ull));
+}
+
+TEST(LatencyHistogramTest, percentile) {
+  latency_histogram h;
+
+  ASSERT_EQ(std::chrono::nanoseconds::zero(), h.percentile(50));
+
+  for (int i = 1; i <= 1000; ++i)
+    h.record(std::chrono::microseconds{i});
+
+  ASSERT_EQ(1000, h.count());
+  ASSERT_EQ(std::chrono::microseconds{1000}, h.max());
+
+  const auto p50 = h.percentile(50);
+  ASSERT_GE(p50, std::chrono::microseconds{500});
+  ASSERT_LE(p50, std::chrono::microseconds{500} * 17 / 16);
+
+  const auto p99 = h.percentile(99);
+  ASSERT_GE(p99, std::chrono::microseconds{990});
+  ASSERT_LE(p99, std::chrono::microseconds{1000});
+
+  h.reset();
+  ASSERT_EQ(0, h.count());
+}
+
+TEST(LatencyHistogramTest, concurrent_record) {
+  latency_histogram h;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&h] {
+        for (int i = 0; i < 10000; ++i)
+          h.record(std::chrono::nanoseconds{i});
+      });
+  }
+
+  for (auto& t : threads)
+    t.join();
+
+  ASSERT_EQ(40000, h.count());
+}
+
+TEST(StatementTracerTest, statements) {
+  tracing::statement_tracer t{4};
+
+  const auto a = t.on_send("SELECT 1");
+  ASSERT_EQ(a, t.on_send("SELECT 1"));
+  ASSERT_NE(a, t.on_send("SELECT 2"));
+
+  tracing::query_trace trace;
+  trace.traced = true;
+  trace.statement = a;
+  trace.sent = tracing::clock::now();
+  trace.first_byte = trace.sent + std::chrono::microseconds{100};
+  trace.result_ready = trace.first_byte + std::chrono::microseconds{10};
+  trace.dispatched = trace.result_ready;
+  trace.completed = trace.dispatched + std::chrono::microseconds{5};
+  trace.rows = 3;
+  t.on_complete(trace);
+
+  const auto stats = t.find("SELECT 1");
+  ASSERT_NE(nullptr, stats);
+  ASSERT_EQ(1, stats->total.count());
+  ASSERT_EQ(3, stats->rows);
+  ASSERT_GE(stats->server.max(), std::chrono::microseconds{100});
+  ASSERT_EQ(nullptr, t.find("SELECT 3"));
+
+  std::size_t n = 0;
+  t.for_each([&n](std::string_view, const auto&) { ++n; });
+  ASSERT_EQ(2, n);
+
+  // Statements that do not fit are not counted.
+  t.on_send("SELECT 3");
+  t.on_send("SELECT 4");
+  ASSERT_EQ(4u, t.on_send("SELECT 5"));
+}
+
+#ifdef POSTGRESPP_TRACING
+
+TEST(TracingTest, connection_traces_queries) {
+  fake_server server;
+
+  fake_server::response res;
+  res.columns = {{"i", 23}};
+  res.latency = std::chrono::milliseconds{20};
+  for (std::int32_t i = 0; i < 10; ++i)
+    res.rows.push_back({fake_server::binary(i)});
+  server.on("SELECT i FROM t WHERE i < $1", res);
+
+  tracing::statement_tracer tracer;
+
+  connection::io_context_t ioc;
+  connection c{ioc, server.conn_string().c_str()};
+  c.set_tracer(&tracer);
+
+  std::size_t called = 0;
+
+  c.enter_pipeline_mode();
+
+  for (int i = 0; i < 3; ++i) {
+    async_exec(c, "SELECT i FROM t WHERE i < $1", [&](auto&& result) {
+          ASSERT_EQ(result::status_t::TUPLES_OK, result.status()) << result.error_message();
+
+          if (++called == 3)
+            c.exit_pipeline_mode();
+        }, std::int32_t{10});
+  }
+
+  ioc.run();
+
+  ASSERT_EQ(3, called);
+
+  const auto stats = tracer.find("SELECT i FROM t WHERE i < $1");
+  ASSERT_NE(nullptr, stats);
+  ASSERT_EQ(3, stats->total.count());
+  ASSERT_EQ(30, stats->rows);
+  ASSERT_GT(stats->bytes_sent, 0);
+  ASSERT_GT(stats->bytes_received, 0);
+  ASSERT_GE(stats->server.max(), std::chrono::milliseconds{20});
+  ASSERT_GE(stats->total.percentile(50), std::chrono::milliseconds{20});
+}
+
+#endif
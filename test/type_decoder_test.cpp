@@ -9,6 +9,9 @@
 
 #include <cstdint>
 #include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
 
 using namespace postgrespp;
 
@@ -128,3 +131,116 @@ TEST_F(TypeDecoderTest, std_optional_floating_point) {
 
   ASSERT_EQ(1, num_calls_);
 }
+
+namespace {
+
+struct test_row {
+  std::int32_t id;
+  std::optional<std::int16_t> si;
+  std::optional<std::string> t;
+  std::optional<double> d;
+};
+
+}
+
+TEST_F(TypeDecoderTest, row_as_tuple) {
+  connection().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_exec(
+            "SELECT id, bi, t FROM " TEST_TABLE " ORDER BY id",
+            wrap_handler([&, shared_txn](auto result) {
+              using row_t = std::tuple<std::int32_t, std::optional<std::int64_t>, std::string>;
+
+              const auto [id, bi, t] = result.at(0).template as<row_t>();
+              ASSERT_EQ(1, id);
+              ASSERT_EQ(40, bi.value());
+              ASSERT_EQ("row 0", t);
+
+              ASSERT_FALSE(std::get<1>(result.at(2).template as<row_t>()).has_value());
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(TypeDecoderTest, result_as_aggregate) {
+  connection().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_exec(
+            "SELECT id, si, t, d FROM " TEST_TABLE " ORDER BY id",
+            wrap_handler([&, shared_txn](auto result) {
+              const auto rows = result.template as<test_row>();
+
+              ASSERT_EQ(4, rows.size());
+              ASSERT_EQ(1, rows[0].id);
+              ASSERT_EQ(10, rows[0].si.value());
+              ASSERT_EQ("row 0", rows[0].t.value());
+              ASSERT_DOUBLE_EQ(3.5, rows[0].d.value());
+              ASSERT_FALSE(rows[2].si.has_value());
+              ASSERT_FALSE(rows[2].t.has_value());
+              ASSERT_EQ("20-chars-long-string", rows[3].t.value());
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(TypeDecoderTest, result_as_mismatch) {
+  connection().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_exec(
+            "SELECT id, bi FROM " TEST_TABLE,
+            wrap_handler([&, shared_txn](auto result) {
+              // bigint does not fit in std::int32_t
+              ASSERT_THROW((result.template as<std::tuple<std::int32_t, std::int32_t>>()), std::length_error);
+              // wrong number of columns
+              ASSERT_THROW((result.template as<std::tuple<std::int32_t>>()), std::length_error);
+              // NULL without std::optional
+              ASSERT_THROW((result.template as<std::tuple<std::int32_t, std::int64_t>>()), std::length_error);
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}
+
+TEST_F(TypeDecoderTest, column) {
+  connection().async_transaction<>([&](auto txn) {
+        auto shared_txn = std::make_shared<work>(std::move(txn));
+
+        shared_txn->async_exec(
+            "SELECT id, bi, d, bi IS NULL FROM " TEST_TABLE " ORDER BY id",
+            wrap_handler([&, shared_txn](auto result) {
+              const auto ids = result.template column<std::int32_t>(0);
+              ASSERT_EQ((std::vector<std::int32_t>{1, 2, 3, 4}), ids);
+
+              std::vector<bool> nulls;
+              const auto bis = result.template column<std::int64_t>(1, &nulls);
+              ASSERT_EQ((std::vector<std::int64_t>{40, 44, 0, 0}), bis);
+              ASSERT_EQ((std::vector<bool>{false, false, true, true}), nulls);
+
+              double ds[4];
+              result.template column<double>(2, ds, &nulls);
+              ASSERT_DOUBLE_EQ(3.5, ds[0]);
+              ASSERT_DOUBLE_EQ(6.5, ds[1]);
+              ASSERT_TRUE(nulls[2]);
+
+              ASSERT_THROW(result.template column<std::int64_t>(1), std::length_error);
+
+              const auto bi_nulls = result.template column<bool>(3);
+              ASSERT_EQ((std::vector<bool>{false, false, true, true}), bi_nulls);
+            }));
+      });
+
+  run();
+
+  ASSERT_EQ(1, num_calls_);
+}